@@ -0,0 +1,80 @@
+/* Decodes a flight recorder dump written by an RX lcore on a loss anomaly:
+ * one line per recorded burst or sleep, with times relative to the trigger. */
+
+#include "dpdklibs/FlightRecorder.hpp"
+
+#include "CLI/App.hpp"
+#include "CLI/Config.hpp"
+#include "CLI/Formatter.hpp"
+
+#include <fmt/core.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dpdklibs;
+
+namespace {
+
+const char*
+trigger_name(uint32_t trigger)
+{
+  switch (static_cast<FlightTrigger>(trigger)) {
+    case FlightTrigger::kPollGap: return "poll gap (ns)";
+    case FlightTrigger::kImissed: return "imissed";
+    case FlightTrigger::kManual:  return "manual";
+    default:                      return "none";
+  }
+}
+
+} // namespace ""
+
+int
+main(int argc, char** argv)
+{
+  std::string file;
+  uint32_t last = 0;
+  uint32_t min_gap_us = 0;
+
+  CLI::App app{ "dpdklibs flight recorder decoder" };
+  app.add_option("file", file, "Dump file")->required();
+  app.add_option("-n,--last", last, "Only show the last N records (default: all)");
+  app.add_option("-g,--min-gap-us", min_gap_us, "Only show records following a gap of at least this many us");
+  CLI11_PARSE(app, argc, argv);
+
+  std::ifstream in(file, std::ios::binary);
+  FlightDumpHeader hdr;
+  std::vector<FlightRecord> records;
+  if (!in || !FlightRecorder::load(in, hdr, records)) {
+    fmt::print("{}: not a flight recorder dump (version {} expected)\n", file, FlightDumpHeader::s_version);
+    return 1;
+  }
+
+  const double us_per_cycle = 1e6 / hdr.tsc_hz;
+  fmt::print("iface {} lcore {}: trigger {} = {}, {} records kept of {} in the run\n",
+             hdr.iface_id, hdr.lcore, trigger_name(hdr.trigger), hdr.trigger_value, hdr.num_records, hdr.total_records);
+  if (records.empty()) {
+    return 0;
+  }
+  const double span_us = (records.back().tsc - records.front().tsc) * us_per_cycle;
+  fmt::print("history spans {:.1f} us before the last record\n\n", span_us);
+
+  fmt::print("{:>6} {:>14} {:>10} {:>6} {:>6} {:>6} {:>12} {:>10}\n",
+             "#", "t-trigger_us", "gap_us", "what", "rx_q", "nb_rx", "dispatch_us", "sleep_us");
+  const std::size_t first = (last && last < records.size()) ? records.size() - last : 0;
+  for (std::size_t i = first; i < records.size(); ++i) {
+    const auto& r = records[i];
+    const double gap_us = i ? (int64_t(r.tsc - records[i - 1].tsc)) * us_per_cycle : 0.;
+    if (gap_us < min_gap_us) {
+      continue;
+    }
+    const bool sleep = r.rx_q == FlightRecord::s_sleep_rxq;
+    fmt::print("{:>6} {:>14.2f} {:>10.2f} {:>6} {:>6} {:>6} {:>12.2f} {:>10.2f}\n",
+               i, int64_t(r.tsc - hdr.trigger_tsc) * us_per_cycle, gap_us, sleep ? "sleep" : "burst",
+               sleep ? std::string("-") : std::to_string(r.rx_q), r.nb_rx,
+               r.dispatch_cycles * us_per_cycle, r.sleep_cycles * us_per_cycle);
+  }
+  return 0;
+}
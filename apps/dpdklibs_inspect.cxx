@@ -0,0 +1,180 @@
+/* Live view of a running DPDK reader: attaches as a secondary process to the
+ * primary's file prefix and shows the per-queue, per-stream and per-lcore
+ * rates from the stats memzones of its interfaces. Only reads the memzones,
+ * the primary's data path is not touched.
+ * Application will run until quit or killed. */
+
+#include "dpdklibs/EALSetup.hpp"
+#include "dpdklibs/StatsMemzone.hpp"
+
+#include "CLI/App.hpp"
+#include "CLI/Config.hpp"
+#include "CLI/Formatter.hpp"
+
+#include <fmt/core.h>
+
+#include <rte_eal.h>
+#include <rte_memzone.h>
+
+#include <chrono>
+#include <csignal>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dpdklibs;
+
+namespace {
+
+volatile std::sig_atomic_t s_quit = 0;
+
+void
+signal_handler(int)
+{
+  s_quit = 1;
+}
+
+double
+per_s(uint64_t now, uint64_t prev, double interval_s)
+{
+  return (interval_s > 0 && now >= prev) ? (now - prev) / interval_s : 0.;
+}
+
+void
+print_zone(const statszone::Zone& cur, const statszone::Zone& prev, bool with_streams)
+{
+  const auto& h = cur.header;
+  const double interval_s = double(h.update_tsc - prev.header.update_tsc) / h.tsc_hz;
+
+  fmt::print("iface {}  imissed {:>12} ({:>10.1f}/s)  rx_nombuf {:>12} ({:>10.1f}/s)\n",
+             h.iface_id, h.imissed, per_s(h.imissed, prev.header.imissed, interval_s),
+             h.rx_nombuf, per_s(h.rx_nombuf, prev.header.rx_nombuf, interval_s));
+
+  fmt::print("  {:>5} {:>5} {:>16} {:>14} {:>10} {:>12} {:>10} {:>10}\n",
+             "queue", "lcore", "sender", "packets", "kpkt/s", "Gbit/s", "fullb/s", "cyc/pkt");
+  for (uint32_t i = 0; i < h.num_queues; ++i) {
+    const auto& q = cur.queues[i];
+    const auto& p = prev.queues[i];
+    const uint64_t d_pkts = q.packets - p.packets;
+    fmt::print("  {:>5} {:>5} {:>16} {:>14} {:>10.1f} {:>12.3f} {:>10.1f} {:>10.0f}\n",
+               q.rx_q, q.lcore, q.src_ip, q.packets,
+               per_s(q.packets, p.packets, interval_s) / 1e3,
+               per_s(q.bytes, p.bytes, interval_s) * 8 / 1e9,
+               per_s(q.full_bursts, p.full_bursts, interval_s),
+               d_pkts ? double(q.work_cycles - p.work_cycles) / d_pkts : 0.);
+  }
+
+  fmt::print("  {:>5} {:>8} {:>8} {:>8} {:>10} {:>10}\n", "lcore", "busy%", "idle%", "sleep%", "kpoll/s", "kpkt/s");
+  for (uint32_t i = 0; i < h.num_lcores; ++i) {
+    const auto& l = cur.lcores[i];
+    const auto& p = prev.lcores[i];
+    const uint64_t busy = l.busy_cycles - p.busy_cycles;
+    const uint64_t idle = l.idle_cycles - p.idle_cycles;
+    const uint64_t sleep = l.sleep_cycles - p.sleep_cycles;
+    const double total = busy + idle + sleep;
+    fmt::print("  {:>5} {:>8.1f} {:>8.1f} {:>8.1f} {:>10.1f} {:>10.1f}\n", l.lcore,
+               total ? 100. * busy / total : 0., total ? 100. * idle / total : 0., total ? 100. * sleep / total : 0.,
+               per_s(l.polls, p.polls, interval_s) / 1e3, per_s(l.packets, p.packets, interval_s) / 1e3);
+  }
+
+  if (!with_streams) {
+    return;
+  }
+  fmt::print("  {:>5} {:>6} {:>9} {:>14} {:>10} {:>12} {:>10} {:>10}\n",
+             "queue", "stream", "source", "frames", "kfr/s", "lost", "gaps", "sink_drop");
+  for (uint32_t i = 0; i < h.num_streams; ++i) {
+    const auto& s = cur.streams[i];
+    fmt::print("  {:>5} {:>6} {:>9} {:>14} {:>10.1f} {:>12} {:>10} {:>10}\n",
+               s.rx_q, s.stream_id, s.source_id, s.frames,
+               per_s(s.frames, prev.streams[i].frames, interval_s) / 1e3,
+               s.lost_frames, s.seq_id_gaps, s.sink_dropped);
+  }
+}
+
+} // namespace ""
+
+int
+main(int argc, char** argv)
+{
+  std::string file_prefix;
+  std::vector<int> ifaces;
+  uint32_t refresh_ms = 1000;
+  bool with_streams = false;
+  bool once = false;
+
+  CLI::App app{ "dpdklibs live inspector" };
+  app.add_option("-p,--file-prefix", file_prefix, "EAL file prefix of the reader (its first PCIe address)")->required();
+  app.add_option("-i,--iface", ifaces, "Interfaces to show (default: 0-7, those found)");
+  app.add_option("-r,--refresh-ms", refresh_ms, "Refresh period in ms");
+  app.add_flag("-s,--streams", with_streams, "Show the per-stream table");
+  app.add_flag("-1,--once", once, "Print one interval and exit");
+  CLI11_PARSE(app, argc, argv);
+
+  if (ifaces.empty()) {
+    for (int i = 0; i < 8; ++i) {
+      ifaces.push_back(i);
+    }
+  }
+
+  std::vector<std::string> eal_args;
+  eal_args.push_back("dpdklibs_inspect");
+  eal_args.push_back("--proc-type=secondary");
+  eal_args.push_back(fmt::format("--file-prefix={}", file_prefix));
+  eal_args.push_back("--no-pci");
+  eal_args.push_back("--log-level=lib.eal:error");
+  ealutils::init_eal(eal_args);
+
+  std::map<int, const statszone::Zone*> zones;
+  for (int iface : ifaces) {
+    const auto* mz = rte_memzone_lookup(statszone::memzone_name(iface).c_str());
+    if (mz == nullptr) {
+      continue;
+    }
+    const auto* zone = static_cast<const statszone::Zone*>(mz->addr);
+    if (zone->header.magic != statszone::s_magic || zone->header.version != statszone::s_version) {
+      fmt::print("Memzone of iface {} has version {}, expected {}: skipped\n", iface, zone->header.version, statszone::s_version);
+      continue;
+    }
+    zones[iface] = zone;
+  }
+  if (zones.empty()) {
+    fmt::print("No dpdklibs stats memzone found with file prefix {}\n", file_prefix);
+    rte_eal_cleanup();
+    return 1;
+  }
+
+  std::signal(SIGINT, signal_handler);
+  std::signal(SIGTERM, signal_handler);
+
+  std::map<int, std::unique_ptr<statszone::Zone>> prev, cur;
+  for (const auto& [iface, zone] : zones) {
+    prev[iface] = std::make_unique<statszone::Zone>();
+    cur[iface] = std::make_unique<statszone::Zone>();
+    statszone::read_zone(zone, *prev[iface]);
+  }
+
+  while (!s_quit) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(refresh_ms));
+    if (!once) {
+      fmt::print("\033[2J\033[H");
+    }
+    for (const auto& [iface, zone] : zones) {
+      if (!statszone::read_zone(zone, *cur[iface])) {
+        fmt::print("iface {}: no consistent snapshot, writer too busy\n", iface);
+        continue;
+      }
+      print_zone(*cur[iface], *prev[iface], with_streams);
+      std::swap(cur[iface], prev[iface]);
+    }
+    std::fflush(stdout);
+    if (once) {
+      break;
+    }
+  }
+
+  rte_eal_cleanup();
+  return 0;
+}
@@ -25,6 +25,11 @@ namespace ealutils {
 
 static volatile uint8_t dpdk_quit_signal; 
 
+// RX offloads requested by default, clipped to the device capabilities at init
+static constexpr uint64_t DEFAULT_RX_OFFLOADS = (RTE_ETH_RX_OFFLOAD_TIMESTAMP
+                                               | RTE_ETH_RX_OFFLOAD_IPV4_CKSUM
+                                               | RTE_ETH_RX_OFFLOAD_UDP_CKSUM);
+
 std::string get_mac_addr_str(const rte_ether_addr& addr);
   
 // Modifies Ethernet device configuration to multi-queue RSS with offload
@@ -33,10 +38,35 @@ void iface_conf_rss_mode(struct rte_eth_conf& iface_conf, bool mode = false, boo
 // Enables RX in promiscuous mode for the Ethernet device.
 int iface_promiscuous_mode(std::uint16_t iface, bool mode = false);
 
+// Builds a port configuration with the requested offloads intersected with the
+// device capabilities and the MTU clamped to the device limits.
+struct rte_eth_conf build_iface_conf(uint16_t iface, const struct rte_eth_dev_info& dev_info,
+                                     uint64_t rx_offloads, uint64_t tx_offloads, uint16_t mtu);
+
+// Burst function description of a queue as reported by the PMD ("n/a" if unsupported)
+std::string get_rx_burst_mode_str(uint16_t iface, uint16_t queue);
+std::string get_tx_burst_mode_str(uint16_t iface, uint16_t queue);
+
+// Heuristic on the PMD burst mode description: vector (SIMD) or scalar path
+bool is_vector_burst_mode(const std::string& burst_mode);
+
+// Link-level (802.3x PAUSE) flow control. mode is one of RTE_ETH_FC_NONE,
+// RTE_ETH_FC_RX_PAUSE, RTE_ETH_FC_TX_PAUSE or RTE_ETH_FC_FULL. With
+// pfc_priority >= 0, priority flow control is set up for that priority instead.
+// Water marks of 0 keep the PMD values.
+int iface_flow_ctrl(uint16_t iface, enum rte_eth_fc_mode mode,
+                    uint32_t high_water, uint32_t low_water,
+                    uint16_t pause_time, bool autoneg, int pfc_priority = -1);
+
+// mtu=0 keeps the jumbo frame default (RTE_JUMBO_ETHER_MTU)
+// With flow_queue_size set, the template/async flow engine is configured before
+// the port is started. It is updated to the applied queue size, 0 if refused.
 int iface_init(uint16_t iface, uint16_t rx_rings, uint16_t tx_rings,
            uint16_t rx_ring_size, uint16_t tx_ring_size,
            std::map<int, std::unique_ptr<rte_mempool>>& mbuf_pool,
-           bool with_reset=false, bool with_mq_rss=false, bool check_link_status=false);
+           bool with_reset=false, bool with_mq_rss=false, bool check_link_status=false,
+           uint16_t mtu=0, uint64_t rx_offloads=DEFAULT_RX_OFFLOADS, bool with_lsc_intr=false,
+           uint32_t* flow_queue_size=nullptr);
 
 std::unique_ptr<rte_mempool> get_mempool(const std::string& pool_name, 
             int num_mbufs=NUM_MBUFS, int mbuf_cache_size=MBUF_CACHE_SIZE,
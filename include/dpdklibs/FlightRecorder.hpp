@@ -0,0 +1,164 @@
+/**
+ * @file FlightRecorder.hpp Per lcore ring of the most recent RX bursts,
+ * frozen and dumped to a binary file when a loss anomaly is detected
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef DPDKLIBS_INCLUDE_DPDKLIBS_FLIGHTRECORDER_HPP_
+#define DPDKLIBS_INCLUDE_DPDKLIBS_FLIGHTRECORDER_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace dunedaq {
+namespace dpdklibs {
+
+struct FlightRecord
+{
+  static constexpr uint16_t s_sleep_rxq = 0xffff; // record of a nanosleep, not a burst
+
+  uint64_t tsc;             // start of the burst processing, or of the sleep
+  uint32_t dispatch_cycles; // burst processing, saturated
+  uint32_t sleep_cycles;    // saturated
+  uint16_t rx_q;
+  uint16_t nb_rx;
+  uint32_t reserved;
+};
+
+enum class FlightTrigger : uint32_t
+{
+  kNone = 0,
+  kPollGap = 1, // set by the lcore
+  kImissed = 2, // requested by the opmon thread
+  kManual = 3
+};
+
+// File layout: FlightDumpHeader, then num_records FlightRecord, oldest first
+struct FlightDumpHeader
+{
+  static constexpr uint32_t s_magic = 0x52465044; // "DPFR"
+  static constexpr uint32_t s_version = 1;
+
+  uint32_t magic;
+  uint32_t version;
+  int32_t iface_id;
+  int32_t lcore;
+  uint32_t trigger;
+  uint32_t num_records;
+  uint64_t tsc_hz;
+  uint64_t trigger_tsc;
+  uint64_t trigger_value; // poll gap in ns, or imissed in the interval
+  uint64_t total_records; // recorded since the start of the run
+};
+
+// Single writer (the lcore). A freeze stops recording until the dump is
+// taken, so the records leading to the trigger survive until then. Only the
+// lcore freezes its recorder: other threads post a request that the next
+// record() applies, and see the freeze through the release store of frozen.
+struct alignas(64) FlightRecorder
+{
+  static constexpr uint32_t s_num_records = 4096;
+
+  std::array<FlightRecord, s_num_records> records{};
+  std::atomic<uint64_t> head{ 0 }; // number of records written
+  std::atomic<uint32_t> frozen{ 0 }; // FlightTrigger, published after the trigger fields
+  uint64_t trigger_tsc = 0;
+  uint64_t trigger_value = 0;
+
+  // Freeze requested by another thread, taken by the lcore
+  std::atomic<uint32_t> freeze_request{ 0 }; // FlightTrigger, published after the request fields
+  std::atomic<uint64_t> request_tsc{ 0 };
+  std::atomic<uint64_t> request_value{ 0 };
+
+  void record(uint64_t tsc, uint16_t rx_q, uint16_t nb_rx, uint64_t dispatch_cycles, uint64_t sleep_cycles)
+  {
+    // Acquire: the dump of the previous freeze is over before the ring is written again
+    if (frozen.load(std::memory_order_acquire)) [[unlikely]] {
+      return;
+    }
+    if (const uint32_t req = freeze_request.load(std::memory_order_acquire)) [[unlikely]] {
+      freeze(static_cast<FlightTrigger>(req), request_tsc.load(std::memory_order_relaxed),
+             request_value.load(std::memory_order_relaxed));
+      freeze_request.store(0, std::memory_order_release);
+      return;
+    }
+    const uint64_t h = head.load(std::memory_order_relaxed);
+    auto& r = records[h & (s_num_records - 1)];
+    r.tsc = tsc;
+    r.dispatch_cycles = dispatch_cycles > UINT32_MAX ? UINT32_MAX : dispatch_cycles;
+    r.sleep_cycles = sleep_cycles > UINT32_MAX ? UINT32_MAX : sleep_cycles;
+    r.rx_q = rx_q;
+    r.nb_rx = nb_rx;
+    head.store(h + 1, std::memory_order_release);
+  }
+
+  // Called by the lcore only. Returns false if already frozen
+  bool freeze(FlightTrigger trigger, uint64_t tsc, uint64_t value)
+  {
+    if (frozen.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    trigger_tsc = tsc;
+    trigger_value = value;
+    frozen.store(static_cast<uint32_t>(trigger), std::memory_order_release);
+    return true;
+  }
+
+  // Called by any other thread, single requester. Returns false if a request is pending
+  bool request_freeze(FlightTrigger trigger, uint64_t tsc, uint64_t value)
+  {
+    if (freeze_request.load(std::memory_order_acquire)) {
+      return false;
+    }
+    request_tsc.store(tsc, std::memory_order_relaxed);
+    request_value.store(value, std::memory_order_relaxed);
+    freeze_request.store(static_cast<uint32_t>(trigger), std::memory_order_release);
+    return true;
+  }
+
+  void thaw() { frozen.store(0, std::memory_order_release); }
+
+  // Not concurrent with the lcore
+  void reset()
+  {
+    head = 0;
+    frozen = 0;
+    freeze_request = 0;
+  }
+
+  // Writes the frozen ring, oldest record first
+  void dump(std::ostream& out, int iface_id, int lcore, uint64_t tsc_hz) const
+  {
+    const uint32_t trigger = frozen.load(std::memory_order_acquire);
+    const uint64_t h = head.load(std::memory_order_acquire);
+    const uint64_t n = h < s_num_records ? h : s_num_records;
+    FlightDumpHeader hdr{ FlightDumpHeader::s_magic, FlightDumpHeader::s_version, iface_id, lcore,
+                          trigger, static_cast<uint32_t>(n), tsc_hz, trigger_tsc, trigger_value, h };
+    out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    for (uint64_t i = h - n; i < h; ++i) {
+      out.write(reinterpret_cast<const char*>(&records[i & (s_num_records - 1)]), sizeof(FlightRecord));
+    }
+  }
+
+  // Reads back a dump, returns false on a bad header or a truncated file
+  static bool load(std::istream& in, FlightDumpHeader& hdr, std::vector<FlightRecord>& out)
+  {
+    if (!in.read(reinterpret_cast<char*>(&hdr), sizeof(hdr)) || hdr.magic != FlightDumpHeader::s_magic ||
+        hdr.version != FlightDumpHeader::s_version) {
+      return false;
+    }
+    out.resize(hdr.num_records);
+    return bool(in.read(reinterpret_cast<char*>(out.data()), hdr.num_records * sizeof(FlightRecord)));
+  }
+};
+
+} // namespace dpdklibs
+} // namespace dunedaq
+
+#endif // DPDKLIBS_INCLUDE_DPDKLIBS_FLIGHTRECORDER_HPP_
@@ -11,22 +11,69 @@
 
 #include <stdint.h>
 #include <rte_flow.h>
+#include <rte_mtr.h>
+
+#include <utility>
+#include <vector>
 
 namespace dunedaq {
 namespace dpdklibs {
 
 static constexpr uint32_t MAX_PATTERN_NUM = 3;
-static constexpr uint32_t MAX_ACTION_NUM  = 2;
+static constexpr uint32_t MAX_ACTION_NUM  = 3;
+static constexpr uint32_t NO_METER = UINT32_MAX;
 
 struct rte_flow *
 generate_ipv4_flow(uint16_t port_id, uint16_t rx_q,
                    uint32_t src_ip, uint32_t src_mask,
                    uint32_t dest_ip, uint32_t dest_mask,
-                   struct rte_flow_error *error);
+                   struct rte_flow_error *error,
+                   uint32_t mtr_id = NO_METER);
+
+// Adds a srTCM meter profile with the given rate ceiling and a policy that
+// passes green/yellow packets and drops red ones.
+int
+setup_sender_meter_policy(uint16_t port_id, uint32_t profile_id, uint32_t policy_id,
+                          uint64_t rate_bytes_per_s, uint64_t burst_bytes,
+                          struct rte_mtr_error *error);
+
+int
+create_sender_meter(uint16_t port_id, uint32_t mtr_id,
+                    uint32_t profile_id, uint32_t policy_id,
+                    struct rte_mtr_error *error);
+
+void
+destroy_sender_meters(uint16_t port_id, const std::vector<uint32_t>& mtr_ids,
+                      uint32_t profile_id, uint32_t policy_id);
 
 struct rte_flow *
 generate_drop_flow(uint16_t port_id, struct rte_flow_error *error);
 
+// Handles of the template based (asynchronous) flow API objects of a port
+struct FlowTemplateContext
+{
+  uint16_t port_id = 0;
+  uint32_t queue_size = 0;
+  struct rte_flow_pattern_template* pattern_template = nullptr;
+  struct rte_flow_actions_template* actions_template = nullptr;
+  struct rte_flow_template_table* table = nullptr;
+  std::vector<struct rte_flow*> flows;
+};
+
+// (rx queue, source IPv4 address in host byte order) pairs to steer
+using rxq_src_ip_list_t = std::vector<std::pair<uint16_t, uint32_t>>;
+
+int
+configure_async_flow_engine(uint16_t port_id, uint32_t nb_rules, uint32_t& queue_size,
+                            struct rte_flow_error *error);
+
+int
+generate_ipv4_flows_async(uint16_t port_id, const rxq_src_ip_list_t& rules,
+                          FlowTemplateContext& ctx, struct rte_flow_error *error);
+
+void
+destroy_flow_templates(FlowTemplateContext& ctx);
+
 } // namespace dpdklibs
 } // namespace dunedaq
 
@@ -56,6 +56,75 @@ ERS_DECLARE_ISSUE(dpdklibs,
                   ((int)ifaceid)((std::string)stage)((int)error)
                 );
 
+ERS_DECLARE_ISSUE(dpdklibs,
+                  FailedToSetupMeter,
+                  "Failed to setup HW meter for interface [" << ifaceid << "], stage " << stage << " : " << error,
+                  ((int)ifaceid)((std::string)stage)((int)error)
+                );
+
+ERS_DECLARE_ISSUE(dpdklibs,
+                  SenderPoliced,
+                  "Sender " << src_ip << " on interface [" << ifaceid << "] exceeds its rate ceiling: "
+                  << dropped << " frames dropped by the HW meter",
+                  ((std::string)src_ip)((int)ifaceid)((uint64_t)dropped)
+                );
+
+ERS_DECLARE_ISSUE(dpdklibs,
+                  BadChecksumFrames,
+                  "Interface [" << ifaceid << "] queue " << rx_q << " (sender " << src_ip << ") received "
+                  << count << " frames with bad IPv4/UDP checksum",
+                  ((int)ifaceid)((int)rx_q)((std::string)src_ip)((uint64_t)count)
+                );
+
+ERS_DECLARE_ISSUE(dpdklibs,
+                  PollGapExceedsRing,
+                  "Lcore " << lcore << " didn't poll interface [" << ifaceid << "] queue " << rx_q
+                  << " for " << gap_us << " us, above the " << ring_time_us << " us the RX ring can absorb at the current rate"
+                  << " (imissed this interval: " << imissed << ")",
+                  ((int)lcore)((int)ifaceid)((int)rx_q)((uint64_t)gap_us)((uint64_t)ring_time_us)((uint64_t)imissed)
+                );
+
+ERS_DECLARE_ISSUE(dpdklibs,
+                  UnexpectedStreamFrames,
+                  "Interface [" << ifaceid << "] queue " << rx_q << " received " << count
+                  << " frames of stream " << stream_id << " from sender " << src_ip
+                  << ", which is not configured for it",
+                  ((int)ifaceid)((int)rx_q)((std::string)src_ip)((int)stream_id)((uint64_t)count)
+                );
+
+ERS_DECLARE_ISSUE(dpdklibs,
+                  SlowConsumer,
+                  "Sink " << sink << " takes " << cost_ns << " ns per frame, above the "
+                  << budget_ns << " ns a frame lasts on the wire at line rate",
+                  ((std::string)sink)((uint64_t)cost_ns)((uint64_t)budget_ns)
+                );
+
+ERS_DECLARE_ISSUE(dpdklibs,
+                  StreamSilent,
+                  "Stream " << stream_id << " (source " << source_id << ") from sender " << src_ip
+                  << " on interface [" << ifaceid << "] queue " << rx_q << " has been silent for " << silent_ms << " ms",
+                  ((int)ifaceid)((int)rx_q)((std::string)src_ip)((int)stream_id)((int)source_id)((uint64_t)silent_ms)
+                );
+
+ERS_DECLARE_ISSUE(dpdklibs,
+                  LinkDown,
+                  "Link of interface [" << ifaceid << "] went down",
+                  ((int)ifaceid)
+                );
+
+ERS_DECLARE_ISSUE(dpdklibs,
+                  PortRecoveryFailed,
+                  "Failed to recover interface [" << ifaceid << "] through a port reset: " << reason,
+                  ((int)ifaceid)((std::string)reason)
+                );
+
+ERS_DECLARE_ISSUE(dpdklibs,
+                  PerfCountersUnavailable,
+                  "Lcore " << lcore << " can't count " << events
+                  << "; check kernel.perf_event_paranoid and the PMU exposed to this host",
+                  ((int)lcore)((std::string)events)
+                );
+
 }
 
 #endif /* DPDKLIBS_INCLUDE_DPDKLIBS_DPDKISSUES_HPP_ */
@@ -0,0 +1,114 @@
+/**
+ * @file LatencyHistogram.hpp Log-linear (HDR style) latency histogram with
+ * a single writer and percentile extraction from interval snapshots
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef DPDKLIBS_INCLUDE_DPDKLIBS_LATENCYHISTOGRAM_HPP_
+#define DPDKLIBS_INCLUDE_DPDKLIBS_LATENCYHISTOGRAM_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace dunedaq {
+namespace dpdklibs {
+
+// Values below 8 have their own bucket, above that every power of two is
+// split in 8 linear sub-buckets (relative error below 12.5%), up to 2^36.
+struct alignas(64) LatencyHistogram
+{
+  static constexpr int s_sub_bits = 3;
+  static constexpr int s_sub_buckets = 1 << s_sub_bits;
+  static constexpr int s_max_log2 = 35;
+  static constexpr int s_num_buckets = (s_max_log2 - s_sub_bits + 2) * s_sub_buckets;
+
+  using counts_t = std::array<uint64_t, s_num_buckets>;
+
+  std::array<std::atomic<uint64_t>, s_num_buckets> counts{};
+  std::atomic<uint64_t> max{ 0 }; // Since last read by the consumer
+
+  static int bucket_of(uint64_t value)
+  {
+    if (value < s_sub_buckets) {
+      return value;
+    }
+    int e = 63 - __builtin_clzll(value);
+    if (e > s_max_log2) {
+      return s_num_buckets - 1;
+    }
+    int sub = (value >> (e - s_sub_bits)) & (s_sub_buckets - 1);
+    return (e - s_sub_bits + 1) * s_sub_buckets + sub;
+  }
+
+  // Highest value falling in a bucket
+  static uint64_t bucket_upper(int bucket)
+  {
+    if (bucket < s_sub_buckets) {
+      return bucket;
+    }
+    int e = bucket / s_sub_buckets + s_sub_bits - 1;
+    int sub = bucket % s_sub_buckets;
+    uint64_t width = uint64_t(1) << (e - s_sub_bits);
+    return (uint64_t(s_sub_buckets + sub) << (e - s_sub_bits)) + width - 1;
+  }
+
+  // Single writer: relaxed load/store instead of a locked increment
+  void record(uint64_t value)
+  {
+    auto& c = counts[bucket_of(value)];
+    c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (value > max.load(std::memory_order_relaxed)) {
+      max.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  // Counts recorded since the previous call, prev is updated
+  void delta(counts_t& prev, counts_t& out) const
+  {
+    for (int b = 0; b < s_num_buckets; ++b) {
+      uint64_t now = counts[b].load(std::memory_order_relaxed);
+      out[b] = now - prev[b];
+      prev[b] = now;
+    }
+  }
+
+  void reset()
+  {
+    for (auto& c : counts) {
+      c = 0;
+    }
+    max = 0;
+  }
+
+  // Upper bound of the bucket holding the q-quantile (0 < q <= 1), 0 if empty
+  static uint64_t percentile(const counts_t& counts, double q)
+  {
+    uint64_t total = 0;
+    for (auto c : counts) {
+      total += c;
+    }
+    if (total == 0) {
+      return 0;
+    }
+    uint64_t rank = q * total;
+    if (rank == 0) {
+      rank = 1;
+    }
+    uint64_t cumulative = 0;
+    for (int b = 0; b < s_num_buckets; ++b) {
+      cumulative += counts[b];
+      if (cumulative >= rank) {
+        return bucket_upper(b);
+      }
+    }
+    return bucket_upper(s_num_buckets - 1);
+  }
+};
+
+} // namespace dpdklibs
+} // namespace dunedaq
+
+#endif // DPDKLIBS_INCLUDE_DPDKLIBS_LATENCYHISTOGRAM_HPP_
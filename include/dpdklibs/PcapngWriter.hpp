@@ -0,0 +1,87 @@
+/**
+ * @file PcapngWriter.hpp Minimal pcapng writer: one section, one Ethernet
+ * interface with nanosecond timestamps, enhanced packet blocks
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef DPDKLIBS_INCLUDE_DPDKLIBS_PCAPNGWRITER_HPP_
+#define DPDKLIBS_INCLUDE_DPDKLIBS_PCAPNGWRITER_HPP_
+
+#include <cstdint>
+#include <ostream>
+
+namespace dunedaq {
+namespace dpdklibs {
+
+class PcapngWriter
+{
+public:
+  static constexpr uint32_t s_shb_type = 0x0A0D0D0A;
+  static constexpr uint32_t s_idb_type = 0x00000001;
+  static constexpr uint32_t s_epb_type = 0x00000006;
+  static constexpr uint32_t s_byte_order_magic = 0x1A2B3C4D;
+  static constexpr uint16_t s_linktype_ethernet = 1;
+  static constexpr uint16_t s_opt_if_tsresol = 9;
+
+  explicit PcapngWriter(std::ostream& out)
+    : m_out(out)
+  {}
+
+  // Section header and the single interface description
+  void write_header(uint32_t snaplen)
+  {
+    // SHB: type, length, magic, version 1.0, section length unknown, length
+    put32(s_shb_type);
+    put32(28);
+    put32(s_byte_order_magic);
+    put16(1);
+    put16(0);
+    put64(UINT64_MAX);
+    put32(28);
+
+    // IDB with if_tsresol = 9 (ns), then end of options
+    put32(s_idb_type);
+    put32(32);
+    put16(s_linktype_ethernet);
+    put16(0);
+    put32(snaplen);
+    put16(s_opt_if_tsresol);
+    put16(1);
+    put32(9); // value byte 9, then 3 bytes of padding (little endian)
+    put32(0);
+    put32(32);
+  }
+
+  // Enhanced packet block, data is padded to 32 bits
+  void write_packet(uint64_t timestamp_ns, const void* data, uint32_t captured_len, uint32_t original_len)
+  {
+    const uint32_t padded = (captured_len + 3) & ~uint32_t(3);
+    const uint32_t total = 32 + padded;
+    put32(s_epb_type);
+    put32(total);
+    put32(0); // interface id
+    put32(timestamp_ns >> 32);
+    put32(timestamp_ns & 0xffffffff);
+    put32(captured_len);
+    put32(original_len);
+    m_out.write(static_cast<const char*>(data), captured_len);
+    static const char zeros[4] = { 0, 0, 0, 0 };
+    m_out.write(zeros, padded - captured_len);
+    put32(total);
+  }
+
+private:
+  // Host byte order, as announced by the byte-order magic
+  void put16(uint16_t v) { m_out.write(reinterpret_cast<const char*>(&v), sizeof(v)); }
+  void put32(uint32_t v) { m_out.write(reinterpret_cast<const char*>(&v), sizeof(v)); }
+  void put64(uint64_t v) { m_out.write(reinterpret_cast<const char*>(&v), sizeof(v)); }
+
+  std::ostream& m_out;
+};
+
+} // namespace dpdklibs
+} // namespace dunedaq
+
+#endif // DPDKLIBS_INCLUDE_DPDKLIBS_PCAPNGWRITER_HPP_
@@ -0,0 +1,184 @@
+/**
+ * @file PerfCounters.hpp Hardware performance counters of the calling
+ * thread through perf_event_open, read in user space with rdpmc when the
+ * kernel allows it
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef DPDKLIBS_INCLUDE_DPDKLIBS_PERFCOUNTERS_HPP_
+#define DPDKLIBS_INCLUDE_DPDKLIBS_PERFCOUNTERS_HPP_
+
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace dunedaq {
+namespace dpdklibs {
+
+// Counts of the thread that opened them, user space only. Every event is
+// opened on its own, so a PMU or a VM lacking one of them keeps the others.
+class PerfCounters
+{
+public:
+  enum Event
+  {
+    kCycles = 0,
+    kInstructions,
+    kLLCMisses,  // last level cache misses, loads and stores
+    kDTLBMisses, // data TLB load misses
+    s_num_events
+  };
+  using counts_t = std::array<uint64_t, s_num_events>;
+
+  static const char* event_name(int e)
+  {
+    static const char* names[s_num_events] = { "cycles", "instructions", "llc_misses", "dtlb_misses" };
+    return names[e];
+  }
+
+  PerfCounters()
+  {
+    m_fd.fill(-1);
+    m_page.fill(nullptr);
+    m_errno.fill(0);
+  }
+  ~PerfCounters() { close(); }
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  // Returns the number of events that could be opened
+  int open()
+  {
+    static const std::array<std::pair<uint32_t, uint64_t>, s_num_events> events{ {
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+      { PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    } };
+    const long page_size = sysconf(_SC_PAGESIZE);
+    int opened = 0;
+    for (int e = 0; e < s_num_events; ++e) {
+      struct perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = events[e].first;
+      attr.config = events[e].second;
+      attr.exclude_kernel = 1; // allowed with perf_event_paranoid <= 2
+      attr.exclude_hv = 1;
+      m_fd[e] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+      if (m_fd[e] < 0) {
+        m_errno[e] = errno;
+        continue;
+      }
+      ++opened;
+      // Without the mapping the counter is still read through read()
+      void* p = mmap(nullptr, page_size, PROT_READ, MAP_SHARED, m_fd[e], 0);
+      if (p != MAP_FAILED) {
+        m_page[e] = static_cast<struct perf_event_mmap_page*>(p);
+      }
+    }
+    return opened;
+  }
+
+  void close()
+  {
+    const long page_size = sysconf(_SC_PAGESIZE);
+    for (int e = 0; e < s_num_events; ++e) {
+      if (m_page[e] != nullptr) {
+        munmap(m_page[e], page_size);
+        m_page[e] = nullptr;
+      }
+      if (m_fd[e] >= 0) {
+        ::close(m_fd[e]);
+        m_fd[e] = -1;
+      }
+    }
+  }
+
+  bool available(int e) const { return m_fd[e] >= 0; }
+
+  uint32_t available_mask() const
+  {
+    uint32_t mask = 0;
+    for (int e = 0; e < s_num_events; ++e) {
+      mask |= available(e) ? (1u << e) : 0;
+    }
+    return mask;
+  }
+
+  // Events that failed to open, with the reason, for the logs
+  std::string unavailable_events() const
+  {
+    std::string s;
+    for (int e = 0; e < s_num_events; ++e) {
+      if (!available(e)) {
+        s += (s.empty() ? "" : ", ") + std::string(event_name(e)) + " (" + std::strerror(m_errno[e]) + ")";
+      }
+    }
+    return s;
+  }
+
+  // Current counts, 0 for unavailable events
+  void read(counts_t& counts) const
+  {
+    for (int e = 0; e < s_num_events; ++e) {
+      counts[e] = available(e) ? read_one(e) : 0;
+    }
+  }
+
+private:
+  uint64_t read_one(int e) const
+  {
+#if defined(__x86_64__)
+    // Self-monitoring protocol of perf_event_mmap_page: the kernel bumps
+    // lock around updates of index/offset. index is 0 while the event isn't
+    // scheduled on a counter (multiplexed), then fall back to read().
+    const struct perf_event_mmap_page* pc = m_page[e];
+    if (pc != nullptr && pc->cap_user_rdpmc) {
+      uint32_t seq, idx;
+      uint64_t count;
+      do {
+        seq = pc->lock;
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        idx = pc->index;
+        count = pc->offset;
+        if (idx) {
+          const int width = pc->pmc_width;
+          uint32_t lo, hi;
+          asm volatile("rdpmc" : "=a"(lo), "=d"(hi) : "c"(idx - 1));
+          int64_t pmc = (uint64_t(hi) << 32) | lo;
+          pmc <<= 64 - width;
+          pmc >>= 64 - width;
+          count += pmc;
+        }
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+      } while (pc->lock != seq);
+      if (idx) {
+        return count;
+      }
+    }
+#endif
+    uint64_t count = 0;
+    return ::read(m_fd[e], &count, sizeof(count)) == sizeof(count) ? count : 0;
+  }
+
+  std::array<int, s_num_events> m_fd;
+  std::array<struct perf_event_mmap_page*, s_num_events> m_page;
+  std::array<int, s_num_events> m_errno;
+};
+
+} // namespace dpdklibs
+} // namespace dunedaq
+
+#endif // DPDKLIBS_INCLUDE_DPDKLIBS_PERFCOUNTERS_HPP_
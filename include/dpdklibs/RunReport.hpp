@@ -0,0 +1,189 @@
+/**
+ * @file RunReport.hpp Interval counters of a run, their binary time series
+ * and the attribution of stream losses to their likely cause
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef DPDKLIBS_INCLUDE_DPDKLIBS_RUNREPORT_HPP_
+#define DPDKLIBS_INCLUDE_DPDKLIBS_RUNREPORT_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace dunedaq {
+namespace dpdklibs {
+namespace runreport {
+
+// Cumulative counters, as read at an interval boundary
+struct PortCounters
+{
+  uint64_t imissed = 0;
+  uint64_t rx_nombuf = 0;
+  uint64_t ierrors = 0;
+};
+
+struct QueueCounters
+{
+  uint64_t frames = 0;
+  uint64_t cksum_bad = 0;
+  uint64_t cksum_dropped = 0;
+  uint64_t unexpected_frames = 0; // streams not configured on the queue
+};
+
+struct StreamLossCounters
+{
+  uint64_t frames = 0;
+  uint64_t lost_frames = 0; // seq_id gaps, in frames
+  uint64_t seq_id_gaps = 0;
+  uint64_t source_dropped = 0; // by the SourceModel of the stream
+};
+
+struct Sample
+{
+  uint64_t tsc = 0;
+  PortCounters port;
+  std::vector<QueueCounters> queues;
+  std::vector<StreamLossCounters> streams;
+};
+
+// Where the lost frames of a stream most likely went
+struct Attribution
+{
+  uint64_t checksum = 0;  // dropped by the checksum policy on the stream's queue
+  uint64_t imissed = 0;   // NIC ran out of RX descriptors
+  uint64_t rx_nombuf = 0; // NIC ran out of mbufs
+  uint64_t upstream = 0;  // no local drop in the interval: lost before the NIC
+
+  uint64_t total() const { return checksum + imissed + rx_nombuf + upstream; }
+};
+
+// Charges, interval by interval, the seq_id losses of each stream to the
+// drops counted in the same interval: first the checksum drops of its queue,
+// then the port imissed and rx_nombuf, the rest upstream. Port drops aren't
+// per stream, so streams are served in slot order until they are used up,
+// and what is left is reported as unattributed (drops of unknown traffic, or
+// of frames whose gap shows up in the next interval).
+class LossAttributor
+{
+public:
+  // Queue index of every stream slot
+  explicit LossAttributor(std::vector<int> slot_queue)
+    : m_slot_queue(std::move(slot_queue))
+    , m_streams(m_slot_queue.size())
+  {}
+
+  void add_interval(const Sample& prev, const Sample& now)
+  {
+    std::vector<uint64_t> cksum(now.queues.size());
+    for (std::size_t q = 0; q < now.queues.size(); ++q) {
+      cksum[q] = delta(now.queues[q].cksum_dropped, prev.queues[q].cksum_dropped);
+    }
+    uint64_t imissed = delta(now.port.imissed, prev.port.imissed);
+    uint64_t rx_nombuf = delta(now.port.rx_nombuf, prev.port.rx_nombuf);
+
+    for (std::size_t s = 0; s < m_streams.size(); ++s) {
+      uint64_t lost = delta(now.streams[s].lost_frames, prev.streams[s].lost_frames);
+      auto& a = m_streams[s];
+      a.checksum += take(lost, cksum[m_slot_queue[s]]);
+      a.imissed += take(lost, imissed);
+      a.rx_nombuf += take(lost, rx_nombuf);
+      a.upstream += lost;
+    }
+    m_unattributed.imissed += imissed;
+    m_unattributed.rx_nombuf += rx_nombuf;
+    for (auto c : cksum) {
+      m_unattributed.checksum += c;
+    }
+  }
+
+  const std::vector<Attribution>& streams() const { return m_streams; }
+  const Attribution& unattributed() const { return m_unattributed; }
+
+  static uint64_t delta(uint64_t now, uint64_t prev) { return now >= prev ? now - prev : now; }
+
+private:
+  static uint64_t take(uint64_t& want, uint64_t& budget)
+  {
+    const uint64_t n = std::min(want, budget);
+    want -= n;
+    budget -= n;
+    return n;
+  }
+
+  std::vector<int> m_slot_queue;
+  std::vector<Attribution> m_streams;
+  Attribution m_unattributed; // upstream unused
+};
+
+// Binary time series: SeriesHeader, the queue index of every stream slot
+// (int32), then one record per interval: tsc, the port counters, the queue
+// counters and the stream counters, all cumulative uint64 in the order of
+// the structs above.
+struct SeriesHeader
+{
+  static constexpr uint32_t s_magic = 0x53525044; // "DPRS"
+  static constexpr uint32_t s_version = 1;
+
+  uint32_t magic;
+  uint32_t version;
+  int32_t iface_id;
+  uint32_t run_number;
+  uint32_t num_queues;
+  uint32_t num_streams;
+  uint64_t tsc_hz;
+};
+
+inline void
+write_series_header(std::ostream& out, const SeriesHeader& hdr, const std::vector<int>& slot_queue)
+{
+  out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+  for (int32_t q : slot_queue) {
+    out.write(reinterpret_cast<const char*>(&q), sizeof(q));
+  }
+}
+
+inline void
+write_series_record(std::ostream& out, const Sample& s)
+{
+  out.write(reinterpret_cast<const char*>(&s.tsc), sizeof(s.tsc));
+  out.write(reinterpret_cast<const char*>(&s.port), sizeof(PortCounters));
+  out.write(reinterpret_cast<const char*>(s.queues.data()), s.queues.size() * sizeof(QueueCounters));
+  out.write(reinterpret_cast<const char*>(s.streams.data()), s.streams.size() * sizeof(StreamLossCounters));
+}
+
+// Reads a whole series back, returns false on a bad header
+inline bool
+read_series(std::istream& in, SeriesHeader& hdr, std::vector<int>& slot_queue, std::vector<Sample>& samples)
+{
+  if (!in.read(reinterpret_cast<char*>(&hdr), sizeof(hdr)) || hdr.magic != SeriesHeader::s_magic ||
+      hdr.version != SeriesHeader::s_version) {
+    return false;
+  }
+  std::vector<int32_t> sq(hdr.num_streams);
+  if (!in.read(reinterpret_cast<char*>(sq.data()), sq.size() * sizeof(int32_t))) {
+    return false;
+  }
+  slot_queue.assign(sq.begin(), sq.end());
+  samples.clear();
+  Sample s;
+  s.queues.resize(hdr.num_queues);
+  s.streams.resize(hdr.num_streams);
+  while (in.read(reinterpret_cast<char*>(&s.tsc), sizeof(s.tsc)) &&
+         in.read(reinterpret_cast<char*>(&s.port), sizeof(PortCounters)) &&
+         in.read(reinterpret_cast<char*>(s.queues.data()), s.queues.size() * sizeof(QueueCounters)) &&
+         in.read(reinterpret_cast<char*>(s.streams.data()), s.streams.size() * sizeof(StreamLossCounters))) {
+    samples.push_back(s);
+  }
+  return true;
+}
+
+} // namespace runreport
+} // namespace dpdklibs
+} // namespace dunedaq
+
+#endif // DPDKLIBS_INCLUDE_DPDKLIBS_RUNREPORT_HPP_
@@ -0,0 +1,116 @@
+/**
+ * @file StatsMemzone.hpp Layout of the statistics block an IfaceWrapper
+ * publishes in a named memzone, for secondary processes to read
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef DPDKLIBS_INCLUDE_DPDKLIBS_STATSMEMZONE_HPP_
+#define DPDKLIBS_INCLUDE_DPDKLIBS_STATSMEMZONE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace dunedaq {
+namespace dpdklibs {
+namespace statszone {
+
+// Bump the version on any layout change: readers refuse other versions
+constexpr uint32_t s_magic = 0x534b5044; // "DPKS"
+constexpr uint32_t s_version = 1;
+
+constexpr uint32_t s_max_queues = 64;
+constexpr uint32_t s_max_streams = 1024;
+constexpr uint32_t s_max_lcores = 64;
+
+inline std::string
+memzone_name(int iface_id)
+{
+  return "dpdklibs_stats_" + std::to_string(iface_id);
+}
+
+struct alignas(64) Header
+{
+  uint32_t magic;
+  uint32_t version;
+  int32_t iface_id;
+  uint32_t num_queues;
+  uint32_t num_streams;
+  uint32_t num_lcores;
+  uint64_t tsc_hz;
+  // Seqlock: odd while the writer updates the records
+  std::atomic<uint64_t> seq;
+  uint64_t update_tsc;
+  uint64_t imissed;
+  uint64_t rx_nombuf;
+};
+
+struct alignas(64) QueueRecord
+{
+  int32_t rx_q;
+  int32_t lcore;
+  char src_ip[16]; // dot-decimal, NUL terminated
+  uint64_t packets;
+  uint64_t bytes;
+  uint64_t full_bursts;
+  uint64_t work_cycles;
+  uint64_t cksum_bad;
+};
+
+struct alignas(64) StreamRecord
+{
+  int32_t rx_q;
+  uint32_t stream_id;
+  uint32_t source_id;
+  uint32_t pad;
+  uint64_t frames;
+  uint64_t bytes;
+  uint64_t lost_frames;
+  uint64_t seq_id_gaps;
+  uint64_t sink_dropped;
+};
+
+struct alignas(64) LcoreRecord
+{
+  int32_t lcore;
+  uint32_t pad;
+  uint64_t busy_cycles;
+  uint64_t idle_cycles;
+  uint64_t sleep_cycles;
+  uint64_t polls;
+  uint64_t packets;
+};
+
+struct Zone
+{
+  Header header;
+  QueueRecord queues[s_max_queues];
+  StreamRecord streams[s_max_streams];
+  LcoreRecord lcores[s_max_lcores];
+};
+
+// Consistent copy of the zone, retried while the writer is active
+inline bool
+read_zone(const Zone* zone, Zone& copy, int max_tries = 100)
+{
+  for (int t = 0; t < max_tries; ++t) {
+    const uint64_t seq0 = zone->header.seq.load(std::memory_order_acquire);
+    if (seq0 & 1) {
+      continue;
+    }
+    __builtin_memcpy(static_cast<void*>(&copy), static_cast<const void*>(zone), sizeof(Zone));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (zone->header.seq.load(std::memory_order_relaxed) == seq0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace statszone
+} // namespace dpdklibs
+} // namespace dunedaq
+
+#endif // DPDKLIBS_INCLUDE_DPDKLIBS_STATSMEMZONE_HPP_
@@ -0,0 +1,107 @@
+/**
+ * @file StreamContinuity.hpp Sequence ID and timestamp continuity of a
+ * single DAQ Ethernet stream, checked on the RX path
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef DPDKLIBS_INCLUDE_DPDKLIBS_STREAMCONTINUITY_HPP_
+#define DPDKLIBS_INCLUDE_DPDKLIBS_STREAMCONTINUITY_HPP_
+
+#include <atomic>
+#include <cstdint>
+
+namespace dunedaq {
+namespace dpdklibs {
+
+// Checks pairs of consecutive frames of a stream: one pair every `stride`
+// frames, so stride 1 checks every frame. The seq_id is 12 bits and wraps at
+// 4096. The timestamp step per frame is learned from the first pair without
+// a seq_id gap, after which a pair is expected to advance by (skip + 1) steps.
+// The check state belongs to the lcore of the stream's queue, the counters are
+// read by the opmon thread.
+struct alignas(64) StreamContinuity
+{
+  static constexpr uint32_t s_seq_id_modulo = 4096;
+
+  // Lcore state
+  uint64_t prev_timestamp = 0;
+  uint64_t timestamp_step = 0;
+  uint32_t frames_to_anchor = 1;
+  uint16_t prev_seq_id = 0;
+  bool anchored = false;
+
+  // Published
+  std::atomic<uint64_t> pairs_checked{ 0 };
+  std::atomic<uint64_t> seq_id_gaps{ 0 };
+  std::atomic<uint64_t> lost_frames{ 0 };
+  std::atomic<uint64_t> max_seq_id_skip{ 0 }; // Since last read by the consumer
+  std::atomic<uint64_t> timestamp_anomalies{ 0 };
+  std::atomic<uint64_t> max_timestamp_deviation{ 0 }; // Since last read by the consumer
+
+  void check(uint16_t seq_id, uint64_t timestamp, uint32_t stride)
+  {
+    if (anchored) {
+      anchored = false;
+      bump(pairs_checked, 1);
+      const uint32_t skip = (seq_id - prev_seq_id - 1) & (s_seq_id_modulo - 1);
+      if (skip) {
+        bump(seq_id_gaps, 1);
+        bump(lost_frames, skip);
+        raise(max_seq_id_skip, skip);
+      }
+      const uint64_t dts = timestamp - prev_timestamp;
+      if (timestamp_step == 0) {
+        if (skip == 0) {
+          timestamp_step = dts;
+        }
+      } else {
+        const uint64_t expected = (skip + 1) * timestamp_step;
+        if (dts != expected) {
+          bump(timestamp_anomalies, 1);
+          raise(max_timestamp_deviation, dts > expected ? dts - expected : expected - dts);
+        }
+      }
+    }
+    if (--frames_to_anchor == 0) {
+      frames_to_anchor = stride;
+      anchored = true;
+      prev_seq_id = seq_id;
+      prev_timestamp = timestamp;
+    }
+  }
+
+  void reset()
+  {
+    prev_timestamp = 0;
+    timestamp_step = 0;
+    frames_to_anchor = 1;
+    prev_seq_id = 0;
+    anchored = false;
+    pairs_checked = 0;
+    seq_id_gaps = 0;
+    lost_frames = 0;
+    max_seq_id_skip = 0;
+    timestamp_anomalies = 0;
+    max_timestamp_deviation = 0;
+  }
+
+private:
+  // Single writer: relaxed load/store instead of a locked increment
+  static void bump(std::atomic<uint64_t>& c, uint64_t v)
+  {
+    c.store(c.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+  }
+  static void raise(std::atomic<uint64_t>& m, uint64_t v)
+  {
+    if (v > m.load(std::memory_order_relaxed)) {
+      m.store(v, std::memory_order_relaxed);
+    }
+  }
+};
+
+} // namespace dpdklibs
+} // namespace dunedaq
+
+#endif // DPDKLIBS_INCLUDE_DPDKLIBS_STREAMCONTINUITY_HPP_
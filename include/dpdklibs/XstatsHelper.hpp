@@ -3,6 +3,10 @@
 
 #include <rte_ethdev.h>
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 namespace dunedaq::dpdklibs {
 
   struct IfaceXstats {
@@ -18,6 +22,9 @@ namespace dunedaq::dpdklibs {
       if (m_xstats_names != nullptr) {
         free(m_xstats_names);
       }
+      if (m_selected_values != nullptr) {
+        free(m_selected_values);
+      }
     }
 
     void setup(int iface) {
@@ -62,6 +69,38 @@ namespace dunedaq::dpdklibs {
       m_allocated = true;
     };
 
+    // Restricts poll() to the given xstat IDs (indices in m_xstats_names).
+    // Values of non-selected xstats are left untouched in m_xstats_values.
+    void select(const std::vector<uint64_t>& ids) {
+      if (!m_allocated) {
+        return;
+      }
+      if (m_xstats_ids != nullptr) {
+        free(m_xstats_ids);
+      }
+      if (m_selected_values != nullptr) {
+        free(m_selected_values);
+      }
+      m_num_selected = ids.size();
+      m_xstats_ids = (uint64_t*)(malloc(sizeof(uint64_t) * std::max<size_t>(m_num_selected, 1)));
+      m_selected_values = (uint64_t*)(malloc(sizeof(uint64_t) * std::max<size_t>(m_num_selected, 1)));
+      std::copy(ids.begin(), ids.end(), m_xstats_ids);
+      m_selected = true;
+    }
+
+    // Index of a named xstat, -1 if the PMD doesn't provide it
+    int find(const std::string& name) const {
+      if (!m_allocated) {
+        return -1;
+      }
+      for (int i = 0; i < m_len; ++i) {
+        if (name == m_xstats_names[i].name) {
+          return i;
+        }
+      }
+      return -1;
+    }
+
     void reset_counters() {
       if (m_allocated) {
         rte_eth_xstats_reset(m_iface_id); //{
@@ -73,7 +112,17 @@ namespace dunedaq::dpdklibs {
 
     void poll() {
       if (m_allocated) {
-        if (m_len != rte_eth_xstats_get_by_id(m_iface_id, nullptr, m_xstats_values, m_len)) {
+        if (m_selected) {
+          if (m_num_selected > 0) {
+            if (m_num_selected != rte_eth_xstats_get_by_id(m_iface_id, m_xstats_ids, m_selected_values, m_num_selected)) {
+              TLOG() << "Cannot get selected xstat values!";
+            } else {
+              for (int i = 0; i < m_num_selected; ++i) {
+                m_xstats_values[m_xstats_ids[i]] = m_selected_values[i];
+              }
+            }
+          }
+        } else if (m_len != rte_eth_xstats_get_by_id(m_iface_id, nullptr, m_xstats_values, m_len)) {
           TLOG() << "Cannot get xstat values!";
         //} else { 
         }
@@ -85,11 +134,16 @@ namespace dunedaq::dpdklibs {
     int m_iface_id;
     bool m_allocated = false;
     struct rte_eth_stats m_eth_stats;
-    struct rte_eth_xstat_name *m_xstats_names;
-    uint64_t *m_xstats_ids;
-    uint64_t *m_xstats_values;
+    struct rte_eth_xstat_name *m_xstats_names = nullptr;
+    uint64_t *m_xstats_ids = nullptr;
+    uint64_t *m_xstats_values = nullptr;
     int m_len;
 
+    // Selection for poll()
+    bool m_selected = false;
+    int m_num_selected = 0;
+    uint64_t *m_selected_values = nullptr;
+
   };
 
 }
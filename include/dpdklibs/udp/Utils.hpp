@@ -70,6 +70,44 @@ set_daqethheader_test_values(detdataformats::DAQEthHeader& daqethheader_obj) noe
 std::string
 get_rte_mbuf_str(const rte_mbuf* mbuf) noexcept;
 
+// Outcome of the NIC's IPv4/UDP checksum verification, from the RX ol_flags
+enum class ChecksumStatus
+{
+  kGood,
+  kBad,
+  kUnknown
+};
+
+inline ChecksumStatus
+get_rx_cksum_status(uint64_t ol_flags) noexcept
+{
+  const uint64_t ip = ol_flags & RTE_MBUF_F_RX_IP_CKSUM_MASK;
+  const uint64_t l4 = ol_flags & RTE_MBUF_F_RX_L4_CKSUM_MASK;
+  if (ip == RTE_MBUF_F_RX_IP_CKSUM_BAD || l4 == RTE_MBUF_F_RX_L4_CKSUM_BAD) {
+    return ChecksumStatus::kBad;
+  }
+  if (ip == RTE_MBUF_F_RX_IP_CKSUM_UNKNOWN || l4 == RTE_MBUF_F_RX_L4_CKSUM_UNKNOWN) {
+    return ChecksumStatus::kUnknown;
+  }
+  return ChecksumStatus::kGood;
+}
+
+// True if every mbuf of the burst has both checksums flagged GOOD. Branchless
+// AND/OR reductions over the burst, so the common case costs one pass.
+inline bool
+burst_cksum_all_good(struct rte_mbuf* const* bufs, uint16_t nb_rx) noexcept
+{
+  constexpr uint64_t mask = RTE_MBUF_F_RX_IP_CKSUM_MASK | RTE_MBUF_F_RX_L4_CKSUM_MASK;
+  constexpr uint64_t good = RTE_MBUF_F_RX_IP_CKSUM_GOOD | RTE_MBUF_F_RX_L4_CKSUM_GOOD;
+  uint64_t acc_and = ~uint64_t(0);
+  uint64_t acc_or = 0;
+  for (uint16_t i = 0; i < nb_rx; ++i) {
+    acc_and &= bufs[i]->ol_flags;
+    acc_or |= bufs[i]->ol_flags;
+  }
+  return (acc_and & mask) == good && (acc_or & mask) == good;
+}
+
 struct StreamUID
 {
   uint64_t det_id : 6;
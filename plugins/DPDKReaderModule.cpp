@@ -15,6 +15,7 @@
 #include "appmodel/DataReaderModule.hpp"
 #include "appmodel/DPDKReaderConf.hpp"
 #include "appmodel/DPDKPortConfiguration.hpp"
+#include "dpdklibs/DPDKReaderTuning.hpp"
 #include "confmodel/ProcessingResource.hpp"
 #include "confmodel/NetworkDevice.hpp"
 #include "confmodel/QueueWithSourceId.hpp"
@@ -32,6 +33,9 @@
 #include "CreateSource.hpp"
 #include "DPDKReaderModule.hpp"
 
+#include <rte_errno.h>
+#include <rte_pdump.h>
+
 #include <cinttypes>
 #include <chrono>
 #include <sstream>
@@ -69,11 +73,15 @@ DPDKReaderModule::DPDKReaderModule(const std::string& name)
   register_command("start", &DPDKReaderModule::do_start);
   register_command("stop_trigger_sources", &DPDKReaderModule::do_stop);
   register_command("scrap", &DPDKReaderModule::do_scrap);
+  register_command("capture", &DPDKReaderModule::do_capture);
 }
 
 DPDKReaderModule::~DPDKReaderModule()
 {
   TLOG() << get_name() << ": Destructor called. Tearing down EAL.";
+  if (m_pdump_initialized) {
+    rte_pdump_uninit();
+  }
   ealutils::finish_eal();
 }
 
@@ -132,6 +140,9 @@ DPDKReaderModule::do_configure(const data_t& /*args*/)
   //auto session = appfwk::ModuleManager::get()->session();
   auto mdal = m_cfg->module<appmodel::DataReaderModule>(get_name());
   auto module_conf = mdal->get_configuration()->cast<appmodel::DPDKReaderConf>();
+  if (auto tuning = module_conf->cast<DPDKReaderTuning>()) {
+    m_pdump_enabled = tuning->get_pdump_enabled();
+  }
   auto res_set = mdal->get_connections();
   // EAL setup
   TLOG() << "Setting up EAL with params from config.";
@@ -197,6 +208,16 @@ DPDKReaderModule::do_configure(const data_t& /*args*/)
 
   ealutils::init_eal(eal_params);
 
+  // Packet capture server for dpdk-dumpcap/dpdk-pdump secondaries
+  if (m_pdump_enabled && !m_pdump_initialized) {
+    if (rte_pdump_init() == 0) {
+      m_pdump_initialized = true;
+      TLOG() << "pdump server enabled, dpdk-dumpcap can attach with --file-prefix=" << first_pcie_addr;
+    } else {
+      TLOG() << "pdump server could not be enabled: " << rte_strerror(rte_errno);
+    }
+  }
+
   // Get available connections from EAL
   auto available_ifaces = ifaceutils::get_num_available_ifaces();
   TLOG() << "Number of available connections: " << available_ifaces;
@@ -261,8 +282,9 @@ DPDKReaderModule::do_configure(const data_t& /*args*/)
 }
 
 void
-DPDKReaderModule::do_start(const data_t&)
+DPDKReaderModule::do_start(const data_t& args)
 {
+  const uint32_t run_number = args.value("run", 0u);
 
   // Setup callbacks on all sourcemodels
   for (auto& [sourceid, source] : m_sources) {
@@ -270,6 +292,7 @@ DPDKReaderModule::do_start(const data_t&)
   }
 
   for (auto& [iface_id, iface] : m_ifaces) {
+    iface->begin_run_report(run_number);
     iface->enable_flow();
   }
 }
@@ -279,6 +302,7 @@ DPDKReaderModule::do_stop(const data_t&)
 {
   for (auto& [iface_id, iface] : m_ifaces) {
     iface->disable_flow();
+    iface->end_run_report();
   }
 }
 
@@ -296,12 +320,36 @@ DPDKReaderModule::do_scrap(const data_t&)
     }
     ealutils::wait_for_lcores();
     TLOG() << "Stoppped DPDK lcore processors and internal threads...";
+    // Run that wasn't stopped
+    for (auto& [iface_id, iface] : m_ifaces) {
+      iface->end_run_report();
+    }
   } else {
     TLOG_DEBUG(5) << "DPDK lcore processor is already stopped!";
   }
 }
 
 
+void
+DPDKReaderModule::do_capture(const data_t& args)
+{
+  // {"iface": 0, "queue": -1, "sender": "", "stream": -1, "count": 1000, "timeout_s": 60, "file": "..."}
+  const uint16_t iface_id = args.value("iface", 0);
+  auto iface_it = m_ifaces.find(iface_id);
+  if (iface_it == m_ifaces.end()) {
+    TLOG() << get_name() << ": capture requested on unknown interface " << iface_id;
+    return;
+  }
+  CaptureRequest req;
+  req.rx_q = args.value("queue", -1);
+  req.stream_id = args.value("stream", -1);
+  req.count = args.value("count", 1000u);
+  req.timeout_s = args.value("timeout_s", 60u);
+  req.file = args.value("file", fmt::format("/tmp/dpdklibs_capture_{}_{}.pcapng", iface_id,
+                                            std::chrono::system_clock::now().time_since_epoch().count()));
+  iface_it->second->start_capture(req, args.value("sender", std::string()));
+}
+
 void 
 DPDKReaderModule::set_running(bool should_run)
 {
@@ -62,10 +62,14 @@ private:
   void do_start(const data_t&);
   void do_stop(const data_t&);
   void do_scrap(const data_t&);
+  void do_capture(const data_t&);
 
   // Internals
   std::shared_ptr<appfwk::ModuleConfiguration> m_cfg;
   
+  bool m_pdump_enabled = false; // lets dpdk-dumpcap attach to the running reader
+  bool m_pdump_initialized = false;
+
   int m_running = 0;
   std::atomic<bool> m_run_marker;
   void set_running(bool /*should_run*/);
@@ -13,11 +13,16 @@
 #include <boost/program_options/parsers.hpp>
 
 #include "dpdklibs/EALSetup.hpp"
+#include "dpdklibs/FlowControl.hpp"
 #include "dpdklibs/Issues.hpp"
 
 #include <rte_eal.h>
 #include <rte_ethdev.h>
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
 namespace dunedaq {
 namespace dpdklibs {
 namespace ealutils {
@@ -37,9 +42,7 @@ static const struct rte_eth_conf iface_conf_default = {
     .mtu = 9000,
     .max_lro_pkt_size = 9000,
     //.split_hdr_size = 0, // deprecated in dpdk@22.10
-    .offloads = (RTE_ETH_RX_OFFLOAD_TIMESTAMP 
-               | RTE_ETH_RX_OFFLOAD_IPV4_CKSUM
-               | RTE_ETH_RX_OFFLOAD_UDP_CKSUM),
+    .offloads = DEFAULT_RX_OFFLOADS,
   },
 
   .txmode = {
@@ -90,14 +93,125 @@ iface_promiscuous_mode(std::uint16_t iface, bool mode)
 }
 
 
+int
+iface_flow_ctrl(uint16_t iface, enum rte_eth_fc_mode mode,
+                uint32_t high_water, uint32_t low_water,
+                uint16_t pause_time, bool autoneg, int pfc_priority)
+{
+  int retval = -1;
+  struct rte_eth_fc_conf fc_conf;
+  memset(&fc_conf, 0, sizeof(struct rte_eth_fc_conf));
+
+  // Start from the current settings, so the PMD specific fields are kept
+  if ((retval = rte_eth_dev_flow_ctrl_get(iface, &fc_conf)) != 0) {
+    TLOG() << "Couldn't get flow control settings of iface[" << iface << "]! Error code: " << retval;
+  }
+  fc_conf.mode = mode;
+  // 0 keeps the water marks of the PMD
+  if (high_water != 0) {
+    fc_conf.high_water = high_water;
+  }
+  if (low_water != 0) {
+    fc_conf.low_water = low_water;
+  }
+  fc_conf.pause_time = pause_time;
+  fc_conf.send_xon = 1;
+  fc_conf.autoneg = autoneg ? 1 : 0;
+
+  if (pfc_priority >= 0) {
+    struct rte_eth_pfc_conf pfc_conf;
+    memset(&pfc_conf, 0, sizeof(struct rte_eth_pfc_conf));
+    pfc_conf.fc = fc_conf;
+    pfc_conf.priority = pfc_priority;
+    retval = rte_eth_dev_priority_flow_ctrl_set(iface, &pfc_conf);
+    if (retval == 0) {
+      TLOG() << "Iface[" << iface << "] PFC set for priority " << pfc_priority << " mode=" << mode;
+      return 0;
+    }
+    TLOG() << "Couldn't set PFC on iface[" << iface << "] (error " << retval << "), falling back to link PAUSE.";
+  }
+
+  retval = rte_eth_dev_flow_ctrl_set(iface, &fc_conf);
+  if (retval != 0) {
+    TLOG() << "Couldn't set flow control on iface[" << iface << "]! Error code: " << retval;
+  } else {
+    TLOG() << "Iface[" << iface << "] flow control mode=" << mode << " high_water=" << high_water
+           << " low_water=" << low_water << " pause_time=" << pause_time << " autoneg=" << autoneg;
+  }
+  return retval;
+}
+
+struct rte_eth_conf
+build_iface_conf(uint16_t iface, const struct rte_eth_dev_info& dev_info,
+                 uint64_t rx_offloads, uint64_t tx_offloads, uint16_t mtu)
+{
+  struct rte_eth_conf iface_conf = iface_conf_default;
+
+  // Offloads not advertised by the PMD are dropped instead of failing configure
+  for (uint64_t bit = 1; bit != 0; bit <<= 1) {
+    if ((rx_offloads & bit) && !(dev_info.rx_offload_capa & bit)) {
+      TLOG() << "Iface[" << iface << "] doesn't support RX offload " << rte_eth_dev_rx_offload_name(bit) << ", not requesting it.";
+    }
+    if ((tx_offloads & bit) && !(dev_info.tx_offload_capa & bit)) {
+      TLOG() << "Iface[" << iface << "] doesn't support TX offload " << rte_eth_dev_tx_offload_name(bit) << ", not requesting it.";
+    }
+  }
+  iface_conf.rxmode.offloads = rx_offloads & dev_info.rx_offload_capa;
+  iface_conf.txmode.offloads = tx_offloads & dev_info.tx_offload_capa;
+
+  uint16_t clamped_mtu = std::clamp(mtu, dev_info.min_mtu, dev_info.max_mtu);
+  if (clamped_mtu != mtu) {
+    TLOG() << "Iface[" << iface << "] MTU " << mtu << " out of device limits [" << dev_info.min_mtu
+           << ", " << dev_info.max_mtu << "], using " << clamped_mtu;
+  }
+  iface_conf.rxmode.mtu = clamped_mtu;
+  iface_conf.rxmode.max_lro_pkt_size = std::min<uint32_t>(clamped_mtu, dev_info.max_lro_pkt_size);
+
+  return iface_conf;
+}
+
+std::string
+get_rx_burst_mode_str(uint16_t iface, uint16_t queue)
+{
+  struct rte_eth_burst_mode mode;
+  if (rte_eth_rx_burst_mode_get(iface, queue, &mode) != 0) {
+    return "n/a";
+  }
+  return std::string(mode.info);
+}
+
+std::string
+get_tx_burst_mode_str(uint16_t iface, uint16_t queue)
+{
+  struct rte_eth_burst_mode mode;
+  if (rte_eth_tx_burst_mode_get(iface, queue, &mode) != 0) {
+    return "n/a";
+  }
+  return std::string(mode.info);
+}
+
+bool
+is_vector_burst_mode(const std::string& burst_mode)
+{
+  std::string lower(burst_mode);
+  std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+  for (const char* tag : { "vector", "vec", "sse", "avx", "neon", "altivec" }) {
+    if (lower.find(tag) != std::string::npos) {
+      return true;
+    }
+  }
+  return false;
+}
 
 int
 iface_init(uint16_t iface, uint16_t rx_rings, uint16_t tx_rings,
            uint16_t rx_ring_size, uint16_t tx_ring_size,
            std::map<int, std::unique_ptr<rte_mempool>>& mbuf_pool,
-           bool with_reset, bool with_mq_rss, bool check_link_status)
+           bool with_reset, bool with_mq_rss, bool check_link_status,
+           uint16_t mtu, uint64_t rx_offloads, bool with_lsc_intr,
+           uint32_t* flow_queue_size)
 {
-  struct rte_eth_conf iface_conf = iface_conf_default;
+  struct rte_eth_conf iface_conf;
   uint16_t nb_rxd = rx_ring_size;
   uint16_t nb_txd = tx_ring_size;
   int retval = -1;
@@ -131,9 +245,15 @@ iface_init(uint16_t iface, uint16_t rx_rings, uint16_t tx_rings,
     }
   }
 
+  // Capability-aware configuration
+  if (mtu == 0) {
+    mtu = RTE_JUMBO_ETHER_MTU;
+  }
+  iface_conf = build_iface_conf(iface, dev_info, rx_offloads, iface_conf_default.txmode.offloads, mtu);
+
   // Should we configure MQ RSS and offload?
   if (with_mq_rss) {
-    iface_conf_rss_mode(iface_conf, true, true); // with_rss, with_offload
+    iface_conf_rss_mode(iface_conf, true, (dev_info.rx_offload_capa & RTE_ETH_RX_OFFLOAD_RSS_HASH) != 0); // with_rss, with_offload
     // RSS
     if ((iface_conf.rxmode.mq_mode & RTE_ETH_MQ_RX_RSS_FLAG) != 0) {
       TLOG() << "Ethdev port config prepared with RX RSS mq_mode!";
@@ -143,13 +263,24 @@ iface_init(uint16_t iface, uint16_t rx_rings, uint16_t tx_rings,
     }
   }
 
+  // Link state change interrupts, if the PMD can raise them
+  if (with_lsc_intr) {
+    if (*dev_info.dev_flags & RTE_ETH_DEV_INTR_LSC) {
+      iface_conf.intr_conf.lsc = 1;
+    } else {
+      TLOG() << "Iface[" << iface << "] has no link state change interrupt, link state will be polled.";
+    }
+  }
+
   // Configure the Ethernet interface
   if ((retval = rte_eth_dev_configure(iface, rx_rings, tx_rings, &iface_conf)) != 0) {
     throw FailedToConfigureInterface(ERS_HERE, iface, "Device Configuration", retval);
   }
 
   // Set MTU of interface
-  rte_eth_dev_set_mtu(iface, RTE_JUMBO_ETHER_MTU);
+  if ((retval = rte_eth_dev_set_mtu(iface, iface_conf.rxmode.mtu)) != 0) {
+    TLOG() << "Couldn't set MTU " << iface_conf.rxmode.mtu << " on iface[" << iface << "]! Error code: " << retval;
+  }
   {
     uint16_t mtu;
     rte_eth_dev_get_mtu(iface, &mtu);
@@ -189,12 +320,24 @@ iface_init(uint16_t iface, uint16_t rx_rings, uint16_t tx_rings,
     }
   }
 
+  // The template/async flow engine can only be configured on a stopped port
+  if (flow_queue_size != nullptr) {
+    struct rte_flow_error error;
+    if ((retval = configure_async_flow_engine(iface, *flow_queue_size, *flow_queue_size, &error)) != 0) {
+      TLOG() << "Iface " << iface << " async flow engine not configured: " << retval
+             << " Message: " << (error.message ? error.message : "n/a");
+      *flow_queue_size = 0;
+    }
+  }
+
   // Start the Ethernet interface.
   if ((retval = rte_eth_dev_start(iface)) < 0) {
       throw FailedToConfigureInterface(ERS_HERE, iface, "MAC address retrival", retval);
   }
 
-  if ((retval = rte_eth_link_get(iface, &link)) != 0) {
+  // Only wait for the link to settle (up to seconds with some PMDs) if it must be up
+  retval = check_link_status ? rte_eth_link_get(iface, &link) : rte_eth_link_get_nowait(iface, &link);
+  if (retval != 0) {
     throw FailedToRetrieveLinkStatus(ERS_HERE, iface, retval);
   }
 
@@ -241,7 +384,11 @@ iface_init(uint16_t iface, uint16_t rx_rings, uint16_t tx_rings,
            << " scattered=" << (queue_info.scattered_rx ? "yes" : "no")
            << " conf.drop_en=" << (queue_info.conf.rx_drop_en ? "yes" : "no")
            << " conf.rx_deferred_start=" << (queue_info.conf.rx_deferred_start ? "yes" : "no")
-           << " rx_buf_size=" << queue_info.rx_buf_size;
+           << " rx_buf_size=" << queue_info.rx_buf_size
+           << " burst_mode=" << get_rx_burst_mode_str(iface, j);
+  }
+  for (size_t j = 0; j < dev_info.nb_tx_queues; j++) {
+    TLOG() << "tx[" << j << "] burst_mode=" << get_tx_burst_mode_str(iface, j);
   }
 
   return 0;
@@ -6,8 +6,13 @@
 
 #include "logging/Logging.hpp"
 
+#include <rte_byteorder.h>
 #include <rte_ip.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
 namespace dunedaq {
 namespace dpdklibs {
 
@@ -29,6 +34,8 @@ namespace dpdklibs {
  *   The mask to apply to the dest ip.
  * @param[out] error
  *   Perform verbose error reporting if not NULL.
+ * @param mtr_id
+ *   Meter to police the matching packets with, NO_METER for none.
  *
  * @return
  *   A flow if the rule could be created else return NULL.
@@ -39,7 +46,8 @@ struct rte_flow *
 generate_ipv4_flow(uint16_t port_id, uint16_t rx_q,
                    uint32_t src_ip, uint32_t src_mask,
                    uint32_t dest_ip, uint32_t dest_mask,
-                   struct rte_flow_error *error)
+                   struct rte_flow_error *error,
+                   uint32_t mtr_id)
 {
   // Declaring structs being used.
   struct rte_flow_attr attr;
@@ -47,6 +55,7 @@ generate_ipv4_flow(uint16_t port_id, uint16_t rx_q,
   struct rte_flow_action action[MAX_ACTION_NUM];
   struct rte_flow *flow = NULL;
   struct rte_flow_action_queue queue = { .index = rx_q };
+  struct rte_flow_action_meter meter = { .mtr_id = mtr_id };
   struct rte_flow_item_ipv4 ip_spec;
   struct rte_flow_item_ipv4 ip_mask;
 
@@ -61,11 +70,17 @@ generate_ipv4_flow(uint16_t port_id, uint16_t rx_q,
   
   /*
    * create the action sequence.
-   * one action only,  move packet to queue
+   * optionally police with a meter, then move packet to queue
    */
-  action[0].type = RTE_FLOW_ACTION_TYPE_QUEUE;
-  action[0].conf = &queue;
-  action[1].type = RTE_FLOW_ACTION_TYPE_END;
+  int a = 0;
+  if (mtr_id != NO_METER) {
+    action[a].type = RTE_FLOW_ACTION_TYPE_METER;
+    action[a].conf = &meter;
+    ++a;
+  }
+  action[a].type = RTE_FLOW_ACTION_TYPE_QUEUE;
+  action[a].conf = &queue;
+  action[a + 1].type = RTE_FLOW_ACTION_TYPE_END;
   
   /*
    * set the first level of the pattern (ETH).
@@ -160,5 +175,315 @@ generate_drop_flow(uint16_t port_id, struct rte_flow_error *error)
   return flow;
 }
 
+int
+setup_sender_meter_policy(uint16_t port_id, uint32_t profile_id, uint32_t policy_id,
+                          uint64_t rate_bytes_per_s, uint64_t burst_bytes,
+                          struct rte_mtr_error *error)
+{
+  struct rte_mtr_meter_profile profile;
+  memset(&profile, 0, sizeof(struct rte_mtr_meter_profile));
+  profile.alg = RTE_MTR_SRTCM_RFC2697;
+  profile.srtcm_rfc2697.cir = rate_bytes_per_s;
+  profile.srtcm_rfc2697.cbs = burst_bytes;
+  profile.srtcm_rfc2697.ebs = 0;
+
+  int res = rte_mtr_meter_profile_add(port_id, profile_id, &profile, error);
+  if (res != 0) {
+    return res;
+  }
+
+  // Green and yellow continue with the rest of the flow actions, red is dropped.
+  static const struct rte_flow_action pass_actions[] = {
+    { .type = RTE_FLOW_ACTION_TYPE_END, .conf = nullptr },
+  };
+  static const struct rte_flow_action drop_actions[] = {
+    { .type = RTE_FLOW_ACTION_TYPE_DROP, .conf = nullptr },
+    { .type = RTE_FLOW_ACTION_TYPE_END, .conf = nullptr },
+  };
+
+  struct rte_mtr_meter_policy_params policy;
+  memset(&policy, 0, sizeof(struct rte_mtr_meter_policy_params));
+  policy.actions[RTE_COLOR_GREEN] = pass_actions;
+  policy.actions[RTE_COLOR_YELLOW] = pass_actions;
+  policy.actions[RTE_COLOR_RED] = drop_actions;
+
+  res = rte_mtr_meter_policy_add(port_id, policy_id, &policy, error);
+  if (res != 0) {
+    struct rte_mtr_error del_error;
+    rte_mtr_meter_profile_delete(port_id, profile_id, &del_error);
+  }
+  return res;
+}
+
+int
+create_sender_meter(uint16_t port_id, uint32_t mtr_id,
+                    uint32_t profile_id, uint32_t policy_id,
+                    struct rte_mtr_error *error)
+{
+  struct rte_mtr_params params;
+  memset(&params, 0, sizeof(struct rte_mtr_params));
+  params.meter_profile_id = profile_id;
+  params.meter_policy_id = policy_id;
+  params.meter_enable = 1;
+  params.stats_mask = RTE_MTR_STATS_N_PKTS_GREEN
+                    | RTE_MTR_STATS_N_PKTS_YELLOW
+                    | RTE_MTR_STATS_N_PKTS_DROPPED
+                    | RTE_MTR_STATS_N_BYTES_DROPPED;
+
+  return rte_mtr_create(port_id, mtr_id, &params, 0, error);
+}
+
+// Destroys the given meters, then the policy and the profile they share.
+// The flow rules using the meters must be destroyed first.
+void
+destroy_sender_meters(uint16_t port_id, const std::vector<uint32_t>& mtr_ids,
+                      uint32_t profile_id, uint32_t policy_id)
+{
+  struct rte_mtr_error error;
+  for (auto mtr_id : mtr_ids) {
+    rte_mtr_destroy(port_id, mtr_id, &error);
+  }
+  rte_mtr_meter_policy_delete(port_id, policy_id, &error);
+  rte_mtr_meter_profile_delete(port_id, profile_id, &error);
+}
+
+namespace {
+
+// Pushes the operations enqueued on a flow queue and pulls the completions of
+// the pending ones. Returns 0 if all of them succeeded.
+int
+flush_flow_queue(uint16_t port_id, uint32_t flow_queue_id, size_t pending,
+                 std::vector<struct rte_flow_op_result>& results, struct rte_flow_error *error)
+{
+  int res = rte_flow_push(port_id, flow_queue_id, error);
+  if (res != 0) {
+    return res;
+  }
+  res = 0;
+  while (pending > 0) {
+    int n = rte_flow_pull(port_id, flow_queue_id, results.data(), results.size(), error);
+    if (n < 0) {
+      return n;
+    }
+    for (int r = 0; r < n; ++r) {
+      if (results[r].status != RTE_FLOW_OP_SUCCESS) {
+        res = -EIO;
+      }
+    }
+    pending -= std::min<size_t>(pending, n);
+  }
+  return res;
+}
+
+} // namespace
+
+// Pre-allocates the flow engine resources of a port for the template based
+// API. Needs the port to be configured but stopped. queue_size is updated to
+// the size of the flow queue actually configured.
+int
+configure_async_flow_engine(uint16_t port_id, uint32_t nb_rules, uint32_t& queue_size,
+                            struct rte_flow_error *error)
+{
+  struct rte_flow_port_info port_info;
+  struct rte_flow_queue_info queue_info;
+  int res = rte_flow_info_get(port_id, &port_info, &queue_info, error);
+  if (res != 0) {
+    return res;
+  }
+  if (port_info.max_nb_queues == 0) {
+    TLOG() << "Port " << port_id << " doesn't support asynchronous flow queues.";
+    return -ENOTSUP;
+  }
+
+  struct rte_flow_port_attr port_attr;
+  memset(&port_attr, 0, sizeof(struct rte_flow_port_attr));
+
+  struct rte_flow_queue_attr queue_attr;
+  memset(&queue_attr, 0, sizeof(struct rte_flow_queue_attr));
+  queue_attr.size = std::min(queue_size, std::max(nb_rules, 1u));
+  if (queue_info.max_size != 0) {
+    queue_attr.size = std::min(queue_attr.size, queue_info.max_size);
+  }
+  const struct rte_flow_queue_attr* queue_attrs[1] = { &queue_attr };
+
+  res = rte_flow_configure(port_id, &port_attr, 1, queue_attrs, error);
+  if (res == 0) {
+    queue_size = queue_attr.size;
+  }
+  return res;
+}
+
+/**
+ * create flow rules that send packets with matching src ip to the selected
+ * queues, through a single template table. Rules are enqueued on flow queue 0
+ * in batches of the flow queue size (ctx.queue_size, as returned by
+ * configure_async_flow_engine), pushed to the HW in one go and their
+ * completions are pulled before the next batch. On a failure the queue is
+ * drained, and the rules created so far are left in ctx for
+ * destroy_flow_templates.
+ *
+ * @return
+ *   0 if every rule was created, a negative errno otherwise.
+ */
+int
+generate_ipv4_flows_async(uint16_t port_id, const rxq_src_ip_list_t& rules,
+                          FlowTemplateContext& ctx, struct rte_flow_error *error)
+{
+  constexpr uint32_t flow_queue_id = 0;
+
+  ctx.port_id = port_id;
+  if (ctx.queue_size == 0) {
+    ctx.queue_size = 64;
+  }
+
+  // Pattern template: any ETH, IPV4 with fully masked source address.
+  struct rte_flow_pattern_template_attr pt_attr;
+  memset(&pt_attr, 0, sizeof(struct rte_flow_pattern_template_attr));
+  pt_attr.relaxed_matching = 1;
+  pt_attr.ingress = 1;
+
+  struct rte_flow_item_ipv4 ip_tmpl_mask;
+  memset(&ip_tmpl_mask, 0, sizeof(struct rte_flow_item_ipv4));
+  ip_tmpl_mask.hdr.src_addr = 0xffffffff;
+
+  struct rte_flow_item tmpl_pattern[MAX_PATTERN_NUM];
+  memset(tmpl_pattern, 0, sizeof(tmpl_pattern));
+  tmpl_pattern[0].type = RTE_FLOW_ITEM_TYPE_ETH;
+  tmpl_pattern[1].type = RTE_FLOW_ITEM_TYPE_IPV4;
+  tmpl_pattern[1].mask = &ip_tmpl_mask;
+  tmpl_pattern[2].type = RTE_FLOW_ITEM_TYPE_END;
+
+  ctx.pattern_template = rte_flow_pattern_template_create(port_id, &pt_attr, tmpl_pattern, error);
+  if (ctx.pattern_template == nullptr) {
+    return -EINVAL;
+  }
+
+  // Actions template: QUEUE with the index left to each rule (NULL mask conf).
+  struct rte_flow_actions_template_attr at_attr;
+  memset(&at_attr, 0, sizeof(struct rte_flow_actions_template_attr));
+  at_attr.ingress = 1;
+
+  struct rte_flow_action tmpl_actions[MAX_ACTION_NUM];
+  struct rte_flow_action tmpl_masks[MAX_ACTION_NUM];
+  memset(tmpl_actions, 0, sizeof(tmpl_actions));
+  memset(tmpl_masks, 0, sizeof(tmpl_masks));
+  tmpl_actions[0].type = RTE_FLOW_ACTION_TYPE_QUEUE;
+  tmpl_actions[1].type = RTE_FLOW_ACTION_TYPE_END;
+  tmpl_masks[0].type = RTE_FLOW_ACTION_TYPE_QUEUE;
+  tmpl_masks[1].type = RTE_FLOW_ACTION_TYPE_END;
+
+  ctx.actions_template = rte_flow_actions_template_create(port_id, &at_attr, tmpl_actions, tmpl_masks, error);
+  if (ctx.actions_template == nullptr) {
+    return -EINVAL;
+  }
+
+  struct rte_flow_template_table_attr table_attr;
+  memset(&table_attr, 0, sizeof(struct rte_flow_template_table_attr));
+  table_attr.flow_attr.group = 0;
+  table_attr.flow_attr.ingress = 1;
+  table_attr.nb_flows = std::max<uint32_t>(rules.size(), 1);
+
+  ctx.table = rte_flow_template_table_create(port_id, &table_attr,
+                                             &ctx.pattern_template, 1,
+                                             &ctx.actions_template, 1, error);
+  if (ctx.table == nullptr) {
+    return -EINVAL;
+  }
+
+  // Per-rule specs must stay alive until the batch they belong to is pushed.
+  std::vector<struct rte_flow_item_ipv4> ip_specs(rules.size());
+  std::vector<struct rte_flow_action_queue> queues(rules.size());
+  std::vector<struct rte_flow_op_result> results(ctx.queue_size);
+
+  struct rte_flow_op_attr op_attr;
+  memset(&op_attr, 0, sizeof(struct rte_flow_op_attr));
+  op_attr.postpone = 1;
+
+  ctx.flows.clear();
+  ctx.flows.reserve(rules.size());
+
+  size_t next = 0;
+  while (next < rules.size()) {
+    const size_t batch_end = std::min(rules.size(), next + ctx.queue_size);
+
+    for (size_t i = next; i < batch_end; ++i) {
+      memset(&ip_specs[i], 0, sizeof(struct rte_flow_item_ipv4));
+      ip_specs[i].hdr.src_addr = rte_cpu_to_be_32(rules[i].second);
+      queues[i].index = rules[i].first;
+
+      struct rte_flow_item pattern[MAX_PATTERN_NUM];
+      memset(pattern, 0, sizeof(pattern));
+      pattern[0].type = RTE_FLOW_ITEM_TYPE_ETH;
+      pattern[1].type = RTE_FLOW_ITEM_TYPE_IPV4;
+      pattern[1].spec = &ip_specs[i];
+      pattern[2].type = RTE_FLOW_ITEM_TYPE_END;
+
+      struct rte_flow_action action[MAX_ACTION_NUM];
+      memset(action, 0, sizeof(action));
+      action[0].type = RTE_FLOW_ACTION_TYPE_QUEUE;
+      action[0].conf = &queues[i];
+      action[1].type = RTE_FLOW_ACTION_TYPE_END;
+
+      struct rte_flow* flow = rte_flow_async_create(port_id, flow_queue_id, &op_attr, ctx.table,
+                                                    pattern, 0, action, 0, nullptr, error);
+      if (flow == nullptr) {
+        // Complete what is already enqueued, keeping the first error
+        struct rte_flow_error drain_error;
+        flush_flow_queue(port_id, flow_queue_id, i - next, results, &drain_error);
+        return -EINVAL;
+      }
+      ctx.flows.push_back(flow);
+    }
+
+    int res = flush_flow_queue(port_id, flow_queue_id, batch_end - next, results, error);
+    if (res != 0) {
+      return res;
+    }
+    next = batch_end;
+  }
+
+  return 0;
+}
+
+// Destroys the rules and the template objects created by generate_ipv4_flows_async
+void
+destroy_flow_templates(FlowTemplateContext& ctx)
+{
+  constexpr uint32_t flow_queue_id = 0;
+  struct rte_flow_error error;
+
+  if (!ctx.flows.empty()) {
+    struct rte_flow_op_attr op_attr;
+    memset(&op_attr, 0, sizeof(struct rte_flow_op_attr));
+    op_attr.postpone = 1;
+    std::vector<struct rte_flow_op_result> results(std::max<uint32_t>(ctx.queue_size, 1));
+    // Same batching as the creation, the queue can't hold more
+    for (size_t next = 0; next < ctx.flows.size(); next += results.size()) {
+      const size_t batch_end = std::min(ctx.flows.size(), next + results.size());
+      size_t enqueued = 0;
+      for (size_t i = next; i < batch_end; ++i) {
+        if (rte_flow_async_destroy(ctx.port_id, flow_queue_id, &op_attr, ctx.flows[i], nullptr, &error) == 0) {
+          ++enqueued;
+        }
+      }
+      flush_flow_queue(ctx.port_id, flow_queue_id, enqueued, results, &error);
+    }
+    ctx.flows.clear();
+  }
+
+  if (ctx.table != nullptr) {
+    rte_flow_template_table_destroy(ctx.port_id, ctx.table, &error);
+    ctx.table = nullptr;
+  }
+  if (ctx.actions_template != nullptr) {
+    rte_flow_actions_template_destroy(ctx.port_id, ctx.actions_template, &error);
+    ctx.actions_template = nullptr;
+  }
+  if (ctx.pattern_template != nullptr) {
+    rte_flow_pattern_template_destroy(ctx.port_id, ctx.pattern_template, &error);
+    ctx.pattern_template = nullptr;
+  }
+}
+
 } // namespace dpdklibs
 } // namespace dunedaq
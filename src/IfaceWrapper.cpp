@@ -21,6 +21,8 @@
 #include "dpdklibs/arp/ARP.hpp"
 #include "dpdklibs/ipv4_addr.hpp"
 #include "IfaceWrapper.hpp"
+#include "Telemetry.hpp"
+#include "TracePoints.hpp"
 
 #include "appfwk/ConfigurationManager.hpp"
 // #include "confmodel/DROStreamConf.hpp"
@@ -29,6 +31,7 @@
 #include "confmodel/DetectorStream.hpp"
 #include "confmodel/ProcessingResource.hpp"
 #include "appmodel/DPDKPortConfiguration.hpp"
+#include "dpdklibs/DPDKPortTuning.hpp"
 // #include "confmodel/NetworkDevice.hpp"
 // #include "appmodel/NICInterfaceConfiguration.hpp"
 // #include "appmodel/NICStatsConf.hpp"
@@ -36,10 +39,19 @@
 
 #include "dpdklibs/opmon/IfaceWrapper.pb.h"
 
+#include <rte_cycles.h>
+#include <rte_errno.h>
+#include <rte_mbuf_dyn.h>
+#include <rte_memzone.h>
+
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <fstream>
 #include <memory>
 #include <string>
 #include <regex>
+#include <thread>
 
 /**
  * @brief TRACE debug levels used in this source file
@@ -54,6 +66,20 @@ enum
 namespace dunedaq {
 namespace dpdklibs {
 
+namespace {
+
+// Increment of a monotonic counter since the previous snapshot, which is
+// updated. A value below the previous one means the counter was reset.
+inline uint64_t
+counter_delta(uint64_t value, uint64_t& prev)
+{
+  uint64_t d = (value >= prev) ? value - prev : value;
+  prev = value;
+  return d;
+}
+
+} // namespace
+
 
 //-----------------------------------------------------------------------------
 IfaceWrapper::IfaceWrapper(
@@ -99,6 +125,49 @@ IfaceWrapper::IfaceWrapper(
 
   m_iface_id_str = iface_cfg->UID();
 
+  // Optional features, when the port configuration is a DPDKPortTuning
+  if (auto tuning = iface_cfg->cast<DPDKPortTuning>()) {
+    m_flow_async = tuning->get_flow_async();
+    m_flow_async_queue_size = tuning->get_flow_async_queue_size();
+    m_sender_rate_limit_mbps = tuning->get_sender_rate_limit_mbps();
+    m_sender_burst_kb = tuning->get_sender_burst_kb();
+    const auto& cksum_policy = tuning->get_checksum_policy();
+    m_cksum_policy = (cksum_policy == "drop") ? ChecksumPolicy::kDrop
+                   : (cksum_policy == "tag")  ? ChecksumPolicy::kTag
+                                              : ChecksumPolicy::kForward;
+    m_rx_offloads = tuning->get_rx_offloads();
+    const auto& fc_mode = tuning->get_link_flow_control();
+    m_set_link_fc = fc_mode != "nic_default";
+    m_fc_mode = (fc_mode == "rx_pause") ? RTE_ETH_FC_RX_PAUSE
+              : (fc_mode == "tx_pause") ? RTE_ETH_FC_TX_PAUSE
+              : (fc_mode == "full")     ? RTE_ETH_FC_FULL
+                                        : RTE_ETH_FC_NONE;
+    m_fc_high_water = tuning->get_fc_high_water();
+    m_fc_low_water = tuning->get_fc_low_water();
+    m_fc_pause_time = tuning->get_fc_pause_time();
+    m_fc_autoneg = tuning->get_fc_autoneg();
+    m_pfc_priority = tuning->get_pfc_priority();
+    m_ring_sample_stride = tuning->get_ring_sample_stride();
+    m_continuity_check_stride = tuning->get_continuity_check_stride();
+    m_unexpected_warning_interval_s = tuning->get_unexpected_warning_interval_s();
+    m_with_stats_zone = tuning->get_stats_memzone();
+    m_monitor_period_ms = tuning->get_monitor_period_ms();
+    m_capture_ring_size = tuning->get_capture_ring_size();
+    m_flight_recorder_enabled = tuning->get_flight_recorder_enabled();
+    m_flight_gap_trigger_us = tuning->get_flight_gap_trigger_us();
+    m_flight_imissed_trigger = tuning->get_flight_imissed_trigger();
+    m_flight_max_dumps = tuning->get_flight_max_dumps();
+    m_flight_dump_dir = tuning->get_flight_dump_dir();
+    m_perf_counters_enabled = tuning->get_perf_counters_enabled();
+    m_perf_sample_period_ms = tuning->get_perf_sample_period_ms();
+    m_run_report_enabled = tuning->get_run_report_enabled();
+    m_run_report_interval_ms = tuning->get_run_report_interval_ms();
+    m_run_report_dir = tuning->get_run_report_dir();
+    m_link_recovery_enabled = tuning->get_link_recovery_enabled();
+    m_link_down_reset_ms = tuning->get_link_down_reset_ms();
+    m_stream_silence_timeout_ms = tuning->get_stream_silence_timeout_ms();
+  }
+
 
   // Here is my list of cores
   for( const auto* proc_res : iface_cfg->get_used_lcores()) {
@@ -133,6 +202,7 @@ IfaceWrapper::IfaceWrapper(
     m_num_bytes_rxq[rx_q] = { 0 };
 
     m_rx_core_map[m_rte_cores[core_idx]][rx_q] = tx_ip;
+    m_rxq_to_ip[rx_q] = tx_ip;
     m_stream_id_to_source_id[rx_q] = strm_src;
 
     ++rx_q;
@@ -141,6 +211,51 @@ IfaceWrapper::IfaceWrapper(
     }
   }
 
+  // Dispatch table
+  for (const auto& [rx_q, strm_src] : m_stream_id_to_source_id) {
+    auto& slots = m_stream_slot[rx_q];
+    slots.fill(-1);
+    for (auto& c : m_unexpected_rxq[rx_q]) {
+      c = 0;
+    }
+    m_prev_unexpected_rxq[rx_q].fill({});
+    for (const auto& [stream_id, sid] : strm_src) {
+      if (stream_id >= s_num_stream_ids) {
+        TLOG() << "Stream ID " << stream_id << " of source " << sid << " doesn't fit in the DAQ Ethernet header, ignored";
+        continue;
+      }
+      auto src_it = m_sources.find(sid);
+      slots[stream_id] = m_slots.size();
+      m_slots.push_back({ rx_q, stream_id, sid, src_it != m_sources.end() ? src_it->second.get() : nullptr });
+    }
+  }
+  m_continuity = std::vector<StreamContinuity>(m_slots.size());
+  m_stream_counters = std::vector<StreamCounters>(m_slots.size());
+  m_prev_stream_counters.resize(m_slots.size());
+  m_last_seen_tsc = std::vector<std::atomic<uint64_t>>(m_slots.size());
+  m_slot_silent.assign(m_slots.size(), 0);
+
+  // Lcore and queue accounting entries are created here, never by the lcores
+  for (auto const& [lcore, rx_qs] : m_rx_core_map) {
+    m_lcore_stats[lcore].reset();
+    m_prev_lcore_stats[lcore] = {};
+    m_lcore_perf[lcore].reset();
+    m_prev_lcore_perf[lcore] = {};
+    m_lcore_parked[lcore] = false;
+    m_flight_recorders[lcore].reset();
+    for (auto const& [rx_q, src_ip] : rx_qs) {
+      m_work_cycles_rxq[rx_q] = 0;
+      m_poll_gap_rxq[rx_q].reset();
+      m_prev_poll_gap_rxq[rx_q].fill(0);
+      m_poll_gap_exceeded_rxq[rx_q] = false;
+      m_rxq_to_lcore[rx_q] = lcore;
+      m_ring_occupancy_rxq[rx_q].reset();
+      m_prev_ring_occupancy_rxq[rx_q] = { 0, 0 };
+      m_latency_rxq[rx_q].reset();
+      m_prev_latency_rxq[rx_q].fill(0);
+    }
+  }
+
   // Log mapping
   for (auto const& [lcore, rx_qs] : m_rx_core_map) {
     TLOG() << "Lcore=" << lcore << " handles: ";
@@ -153,6 +268,9 @@ IfaceWrapper::IfaceWrapper(
   TLOG() << "Append TX_Q=0 for ARP responses.";
   m_tx_qs.insert(0);
 
+  m_capture = std::make_unique<PacketCapture>(m_iface_id, m_socket_id, m_capture_ring_size);
+
+  telemetry::register_iface(m_iface_id, this);
 }
 
 
@@ -161,8 +279,19 @@ IfaceWrapper::~IfaceWrapper()
 {
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << "IfaceWrapper destructor called. First stop check, then closing iface.";
     
+  telemetry::deregister_iface(m_iface_id);
+  if (m_eth_callbacks_registered) {
+    rte_eth_dev_callback_unregister(m_iface_id, RTE_ETH_EVENT_INTR_LSC, &IfaceWrapper::eth_event_callback, this);
+    rte_eth_dev_callback_unregister(m_iface_id, RTE_ETH_EVENT_INTR_RESET, &IfaceWrapper::eth_event_callback, this);
+  }
+  if (m_stats_zone != nullptr) {
+    rte_memzone_free(m_stats_zone);
+  }
+
   struct rte_flow_error error;
+  destroy_flow_templates(m_flow_templates);
   rte_flow_flush(m_iface_id, &error);
+  destroy_meters();
   //graceful_stop();
   //close_iface();
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << "IfaceWrapper destroyed.";
@@ -201,52 +330,215 @@ IfaceWrapper::setup_interface()
   bool with_reset = true, with_mq_mode = true; // go to config
   bool check_link_status = false;
 
-  int retval = ealutils::iface_init(m_iface_id, m_rx_qs.size(), m_tx_qs.size(), m_rx_ring_size, m_tx_ring_size, m_mbuf_pools, with_reset, with_mq_mode, check_link_status);
+  // The async flow engine is sized once per port configuration, before the start
+  m_flow_queue_size = m_flow_async_queue_size;
+  int retval = ealutils::iface_init(m_iface_id, m_rx_qs.size(), m_tx_qs.size(), m_rx_ring_size, m_tx_ring_size, m_mbuf_pools, with_reset, with_mq_mode, check_link_status, m_mtu, m_rx_offloads, m_link_recovery_enabled,
+                                    m_flow_async ? &m_flow_queue_size : nullptr);
   if (retval != 0 ) {
     throw FailedToSetupInterface(ERS_HERE, m_iface_id, retval);
   }
+
+  // What the PMD actually runs with
+  struct rte_eth_conf applied_conf;
+  if (rte_eth_dev_conf_get(m_iface_id, &applied_conf) == 0) {
+    m_applied_rx_offloads = applied_conf.rxmode.offloads;
+    m_lsc_intr = applied_conf.intr_conf.lsc;
+  }
+  if (m_link_recovery_enabled && !m_eth_callbacks_registered) {
+    rte_eth_dev_callback_register(m_iface_id, RTE_ETH_EVENT_INTR_LSC, &IfaceWrapper::eth_event_callback, this);
+    rte_eth_dev_callback_register(m_iface_id, RTE_ETH_EVENT_INTR_RESET, &IfaceWrapper::eth_event_callback, this);
+    m_eth_callbacks_registered = true;
+  }
+  rte_eth_dev_get_mtu(m_iface_id, &m_applied_mtu);
+  m_rx_vector_path = true;
+  std::set<std::string> rx_modes;
+  for (const auto& rx_q : m_rx_qs) {
+    auto mode = ealutils::get_rx_burst_mode_str(m_iface_id, rx_q);
+    m_rx_vector_path &= ealutils::is_vector_burst_mode(mode);
+    rx_modes.insert(mode);
+  }
+  m_rx_burst_mode.clear();
+  for (const auto& mode : rx_modes) {
+    m_rx_burst_mode += (m_rx_burst_mode.empty() ? "" : " / ") + mode;
+  }
+  m_tx_burst_mode = ealutils::get_tx_burst_mode_str(m_iface_id, 0);
+  m_tx_vector_path = ealutils::is_vector_burst_mode(m_tx_burst_mode);
+  TLOG() << "Iface[" << m_iface_id << "] RX offloads requested=0x" << std::hex << m_rx_offloads
+         << " applied=0x" << m_applied_rx_offloads << std::dec
+         << " MTU=" << m_applied_mtu << " RX vector path=" << m_rx_vector_path << " TX vector path=" << m_tx_vector_path;
   // Promiscuous mode
   ealutils::iface_promiscuous_mode(m_iface_id, m_prom_mode); // should come from config
+
+  // HW RX timestamps, if the PMD kept the offload and registered the dynfield
+  m_hw_timestamps = false;
+  if (m_applied_rx_offloads & RTE_ETH_RX_OFFLOAD_TIMESTAMP) {
+    if (rte_mbuf_dyn_rx_timestamp_register(&m_ts_dynfield_offset, &m_ts_dynflag) == 0) {
+      uint64_t clock;
+      if (rte_eth_read_clock(m_iface_id, &clock) == 0) {
+        m_hw_timestamps = true;
+        calibrate_nic_clock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        calibrate_nic_clock();
+      }
+    }
+  }
+  TLOG() << "Iface[" << m_iface_id << "] latency measured from "
+         << (m_hw_timestamps ? "HW RX timestamps" : "TSC at burst time");
+
+  // Link-level flow control
+  if (m_set_link_fc) {
+    ealutils::iface_flow_ctrl(m_iface_id, m_fc_mode, m_fc_high_water, m_fc_low_water,
+                              m_fc_pause_time, m_fc_autoneg, m_pfc_priority);
+  }
 }
 
 
+//-----------------------------------------------------------------------------
+void
+IfaceWrapper::calibrate_nic_clock()
+{
+  // Pair a NIC clock reading with the TSC, the slope comes from the previous pair
+  uint64_t nic;
+  const uint64_t tsc_before = rte_rdtsc();
+  if (rte_eth_read_clock(m_iface_id, &nic) != 0) {
+    return;
+  }
+  const uint64_t tsc = (tsc_before + rte_rdtsc()) / 2;
+
+  const auto& prev = m_clock_calib;
+  ClockCalibration next;
+  next.tsc_per_nic = (prev.nic0 != 0 && nic > prev.nic0) ? double(tsc - prev.tsc0) / (nic - prev.nic0) : prev.tsc_per_nic;
+  next.nic0 = nic;
+  next.tsc0 = tsc;
+  m_clock_calib = next;
+
+  const uint32_t seq = m_clock_calib_seq.load(std::memory_order_relaxed);
+  m_clock_calib_seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  m_clock_calib_nic0.store(next.nic0, std::memory_order_relaxed);
+  m_clock_calib_tsc0.store(next.tsc0, std::memory_order_relaxed);
+  m_clock_calib_tsc_per_nic.store(next.tsc_per_nic, std::memory_order_relaxed);
+  m_clock_calib_seq.store(seq + 2, std::memory_order_release);
+}
+
 //-----------------------------------------------------------------------------
 void
 IfaceWrapper::setup_flow_steering()
+{
+  if (install_flow_steering() != 0) {
+    ers::fatal(dunedaq::datahandlinglibs::InitializationError(
+      ERS_HERE, "Couldn't create Flow API rules!"));
+    rte_exit(EXIT_FAILURE, "error in creating flow");
+  }
+}
+
+//-----------------------------------------------------------------------------
+int
+IfaceWrapper::install_flow_steering()
 {
   // Flow steering setup
   TLOG() << "Configuring Flow steering rules for iface=" << m_iface_id;
   struct rte_flow_error error;
   struct rte_flow *flow;
   TLOG() << "Attempt to flush previous flow rules...";
+  destroy_flow_templates(m_flow_templates);
   rte_flow_flush(m_iface_id, &error);
 #warning RS: FIXME -> Check for flow flush return!
+  // The meters of a previous setup, no rule uses them anymore
+  destroy_meters();
+
+  // Parse the sender IPs once, outside of the rule creation loop
+  rxq_src_ip_list_t rules;
   for (auto const& [lcoreid, rxqs] : m_rx_core_map) {
     for (auto const& [rxqid, srcip] : rxqs) {
-      // Put the IP numbers temporarily in a vector, so they can be converted easily to uint32_t
-      TLOG() << "Creating flow rule for src_ip=" << srcip << " assigned to rxq=" << rxqid;
-      size_t ind = 0, current_ind = 0;
-      std::vector<uint8_t> v;
-      for (int i = 0; i < 4; ++i) {
-        v.push_back(std::stoi(srcip.substr(current_ind, srcip.size() - current_ind), &ind));
-        current_ind += ind + 1;
+      IpAddr ip(srcip);
+      rules.emplace_back(rxqid, RTE_IPV4(ip.addr_bytes[0], ip.addr_bytes[1], ip.addr_bytes[2], ip.addr_bytes[3]));
+    }
+  }
+
+  // Optional HW policing: one meter per sender, shared profile and policy
+  if (m_sender_rate_limit_mbps > 0) {
+    struct rte_mtr_error mtr_error;
+    int retval = setup_sender_meter_policy(m_iface_id, s_meter_profile_id, s_meter_policy_id,
+                                           uint64_t(m_sender_rate_limit_mbps) * 1000000 / 8,
+                                           uint64_t(m_sender_burst_kb) * 1024, &mtr_error);
+    if (retval != 0) {
+      ers::warning(FailedToSetupMeter(ERS_HERE, m_iface_id, "Meter profile/policy", retval));
+    } else {
+      m_meter_policy_installed = true;
+      for (auto const& [rxqid, src_ip] : rules) {
+        if ((retval = create_sender_meter(m_iface_id, rxqid, s_meter_profile_id, s_meter_policy_id, &mtr_error)) != 0) {
+          ers::warning(FailedToSetupMeter(ERS_HERE, m_iface_id, "Meter creation", retval));
+          continue;
+        }
+        m_rxq_meters[rxqid] = rxqid;
+        m_prev_meter_stats[rxqid] = {};
       }
+      TLOG() << "Policing " << m_rxq_meters.size() << " senders at " << m_sender_rate_limit_mbps << " Mbps each.";
+    }
+  }
+
+  auto t_start = std::chrono::steady_clock::now();
+  bool installed_async = false;
+
+  // The flow engine was configured by setup_interface, a queue size of 0 means it was refused.
+  // Metered rules are only supported on the synchronous path.
+  if (m_flow_async && m_flow_queue_size > 0 && m_rxq_meters.empty()) {
+    TLOG() << "Creating " << rules.size() << " flow rules through the template/async flow API.";
+    m_flow_templates.queue_size = m_flow_queue_size;
+    int retval = generate_ipv4_flows_async(m_iface_id, rules, m_flow_templates, &error);
+
+    if (retval == 0) {
+      installed_async = true;
+    } else {
+      TLOG() << "Async flow installation failed with " << retval
+             << " Error type: " << (unsigned)error.type
+             << " Message: " << (error.message ? error.message : "n/a")
+             << ". Falling back to synchronous rule creation.";
+      destroy_flow_templates(m_flow_templates);
+    }
+  }
 
-      flow = generate_ipv4_flow(m_iface_id, rxqid,
-        RTE_IPV4(v[0], v[1], v[2], v[3]), 0xffffffff, 0, 0, &error);
+  if (!installed_async) {
+    for (auto const& [rxqid, src_ip] : rules) {
+      TLOG() << "Creating flow rule for src_ip=" << udp::get_ipv4_decimal_addr_str(udp::ip_address_binary_to_dotdecimal(src_ip))
+             << " assigned to rxq=" << rxqid;
+      auto mtr_it = m_rxq_meters.find(rxqid);
+      uint32_t mtr_id = (mtr_it != m_rxq_meters.end()) ? mtr_it->second : NO_METER;
+      flow = generate_ipv4_flow(m_iface_id, rxqid, src_ip, 0xffffffff, 0, 0, &error, mtr_id);
 
-      if (not flow) { // ers::fatal
+      if (not flow) {
         TLOG() << "Flow can't be created for " << rxqid
          << " Error type: " << (unsigned)error.type
-         << " Message: " << error.message;
-        ers::fatal(dunedaq::datahandlinglibs::InitializationError(
-          ERS_HERE, "Couldn't create Flow API rules!"));
-        rte_exit(EXIT_FAILURE, "error in creating flow");
+         << " Message: " << (error.message ? error.message : "n/a");
+        return -EINVAL;
       }
     }
   }
 
-  return;
+  auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t_start).count();
+  TLOG() << "Flow steering for iface=" << m_iface_id << ": " << rules.size() << " rules installed in "
+         << elapsed_us << " us (" << (rules.empty() ? 0 : elapsed_us / rules.size()) << " us/rule) using the "
+         << (installed_async ? "template/async" : "synchronous") << " flow API.";
+  dpdklibs_trace_flow_install(m_iface_id, rules.size(), installed_async, rte_rdtsc(), elapsed_us);
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+void
+IfaceWrapper::destroy_meters()
+{
+  if (!m_meter_policy_installed) {
+    return;
+  }
+  std::vector<uint32_t> mtr_ids;
+  for (const auto& [rx_q, mtr_id] : m_rxq_meters) {
+    mtr_ids.push_back(mtr_id);
+  }
+  destroy_sender_meters(m_iface_id, mtr_ids, s_meter_profile_id, s_meter_policy_id);
+  m_rxq_meters.clear();
+  m_meter_policy_installed = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -256,6 +548,71 @@ IfaceWrapper::setup_xstats()
   // Stats setup
   m_iface_xstats.setup(m_iface_id);
   m_iface_xstats.reset_counters();
+
+  // PAUSE frame counters have PMD specific names
+  static const std::array<std::vector<std::string>, s_num_pause_stats> pause_names{{
+    { "rx_xon_packets", "rx_priority0_xon_packets" },
+    { "rx_xoff_packets", "rx_pause_ctrl_phy", "rx_priority0_xoff_packets" },
+    { "tx_xon_packets", "tx_priority0_xon_packets" },
+    { "tx_xoff_packets", "tx_pause_ctrl_phy", "tx_priority0_xoff_packets" },
+  }};
+  for (int p = 0; p < s_num_pause_stats; ++p) {
+    for (const auto& name : pause_names[p]) {
+      if ((m_pause_xstat_idx[p] = m_iface_xstats.find(name)) >= 0) {
+        break;
+      }
+    }
+  }
+  m_pause_xstat_prev.fill(0);
+  memset(&m_prev_eth_stats, 0, sizeof(struct rte_eth_stats));
+  m_last_opmon_tsc = rte_rdtsc();
+
+  // Classify the xstat names once: queue counters, errors and the rest, and
+  // resolve the protobuf field each of them is published into.
+  static const std::regex queue_regex(R"((rx|tx)_q(\d+)_([^_]+))");
+  static const std::regex err_regex(R"(.+error.*)");
+  std::map<std::string, std::size_t> queue_label_idx;
+  std::set<uint64_t> selected_ids;
+
+  m_xstat_targets.clear();
+  m_xstat_queue_labels.clear();
+  for (int i = 0; i < m_iface_xstats.m_len; ++i) {
+    std::string name(m_iface_xstats.m_xstats_names[i].name);
+    std::smatch match;
+    XstatTarget target{ i, XstatGroup::kInfo, nullptr, 0 };
+
+    if (std::regex_match(name, match, queue_regex)) {
+      auto queue_name = match[1].str() + '-' + match[2].str();
+      auto [it, inserted] = queue_label_idx.try_emplace(queue_name, m_xstat_queue_labels.size());
+      if (inserted) {
+        m_xstat_queue_labels.push_back(queue_name);
+      }
+      target.group = XstatGroup::kQueue;
+      target.queue = it->second;
+      target.field = opmon::QueueEthXStats::descriptor()->FindFieldByName(match[3].str());
+    } else if (std::regex_match(name, err_regex)) {
+      target.group = XstatGroup::kErrors;
+      target.field = opmon::EthXStatsErrors::descriptor()->FindFieldByName(name);
+    } else {
+      target.field = opmon::EthXStatsInfo::descriptor()->FindFieldByName(name);
+    }
+
+    if (target.field == nullptr || target.field->cpp_type() != google::protobuf::FieldDescriptor::CPPTYPE_UINT64) {
+      TLOG_DEBUG(TLVL_WORK_STEPS) << "Xstat " << name << " has no opmon field, won't be published.";
+      continue;
+    }
+    m_xstat_targets.push_back(target);
+    selected_ids.insert(i);
+  }
+
+  for (const auto& idx : m_pause_xstat_idx) {
+    if (idx >= 0) {
+      selected_ids.insert(idx);
+    }
+  }
+  m_iface_xstats.select(std::vector<uint64_t>(selected_ids.begin(), selected_ids.end()));
+  TLOG() << "Iface[" << m_iface_id << "] publishes " << m_xstat_targets.size() << " of "
+         << m_iface_xstats.m_len << " xstats, polling " << selected_ids.size() << " of them by ID.";
 }
 
 
@@ -268,6 +625,79 @@ IfaceWrapper::start()
     m_num_bytes_rxq[rx_q] = { 0 };
     m_num_full_bursts[rx_q] = { 0 };
     m_max_burst_size[rx_q] = { 0 };
+    m_num_cksum_bad_rxq[rx_q] = { 0 };
+    m_num_cksum_unknown_rxq[rx_q] = { 0 };
+    m_num_cksum_dropped_rxq[rx_q] = { 0 };
+    m_last_cksum_bad_rxq[rx_q] = 0;
+    m_prev_frames_rxq[rx_q] = 0;
+    m_prev_bytes_rxq[rx_q] = 0;
+    m_work_cycles_rxq[rx_q] = 0;
+    m_prev_work_cycles_rxq[rx_q] = 0;
+    m_poll_gap_rxq[rx_q].reset();
+    m_prev_poll_gap_rxq[rx_q].fill(0);
+    m_ring_occupancy_rxq[rx_q].reset();
+    m_prev_ring_occupancy_rxq[rx_q] = { 0, 0 };
+    m_latency_rxq[rx_q].reset();
+    m_prev_latency_rxq[rx_q].fill(0);
+  }
+  for (auto& c : m_continuity) {
+    c.reset();
+  }
+  for (auto& c : m_stream_counters) {
+    c.reset();
+  }
+  m_prev_stream_counters.assign(m_slots.size(), {});
+  for (auto& t : m_last_seen_tsc) {
+    t = 0;
+  }
+  m_slot_silent.assign(m_slots.size(), 0);
+  m_watch_since_tsc = 0;
+  m_silent_streams = 0;
+  m_silence_events = 0;
+  for (auto& [rx_q, counts] : m_unexpected_rxq) {
+    for (auto& c : counts) {
+      c = 0;
+    }
+    m_prev_unexpected_rxq[rx_q].fill({});
+  }
+  m_ns_per_tsc_cycle = 1e9 / rte_get_tsc_hz();
+  for (auto& [lcore, stats] : m_lcore_stats) {
+    stats.reset();
+    m_prev_lcore_stats[lcore] = {};
+    m_lcore_perf[lcore].reset();
+    m_prev_lcore_perf[lcore] = {};
+    m_flight_recorders[lcore].reset();
+  }
+  m_flight_dumps = 0;
+  for (auto& [lcore, parked] : m_lcore_parked) {
+    parked = false;
+  }
+  m_rx_paused = false;
+  m_lsc_interrupts = 0;
+  m_reset_events = 0;
+  m_reset_requested = false;
+  m_link_down_events = 0;
+  m_link_downtime_ns = 0;
+  m_link_longest_down_ns = 0;
+  m_link_last_down_ns = 0;
+  m_port_resets = 0;
+  m_failed_resets = 0;
+  m_link_recovering = false;
+  m_link_down_since_tsc = 0;
+  m_link_up = true;
+  {
+    struct rte_eth_link link;
+    if (rte_eth_link_get_nowait(m_iface_id, &link) == 0 && !link.link_status) {
+      // Down from the start: the outage counts from now
+      m_link_up = false;
+      m_link_recovering = true;
+      m_link_down_since_tsc = rte_rdtsc();
+      m_link_down_events = 1;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lk(m_link_mutex);
+    m_link_down_intervals.clear();
   }
   
   
@@ -275,6 +705,14 @@ IfaceWrapper::start()
   m_lcore_quit_signal.store(false);
   TLOG() << "Launching GARP thread with garp_func...";
   m_garp_thread = std::thread(&IfaceWrapper::garp_func, this);
+
+  if (m_with_stats_zone) {
+    setup_stats_zone();
+  }
+  if (m_stats_zone != nullptr || m_flight_recorder_enabled || m_run_report_enabled || m_link_recovery_enabled ||
+      m_stream_silence_timeout_ms) {
+    m_monitor_thread = std::thread(&IfaceWrapper::monitor_func, this);
+  }
   
 
   TLOG() << "Interface id=" << m_iface_id << " starting LCore processors:";
@@ -296,6 +734,10 @@ IfaceWrapper::stop()
   } else {
     TLOG() << "GARP thrad is not joinable!";
   }
+  if (m_monitor_thread.joinable()) {
+    m_monitor_thread.join();
+  }
+  m_capture->stop();
 }
 /*
 void
@@ -311,76 +753,1102 @@ IfaceWrapper::scrap()
 void 
 IfaceWrapper::generate_opmon_data() {
 
+  auto cycle_start = std::chrono::steady_clock::now();
+
+  // Not while the monitor thread reconfigures the port: skip this cycle,
+  // the next one covers the interval
+  std::unique_lock<std::mutex> port_lock(m_port_mutex, std::try_to_lock);
+  if (!port_lock.owns_lock()) {
+    TLOG_DEBUG(TLVL_WORK_STEPS) << "Iface[" << m_iface_id << "] being reset, opmon cycle skipped.";
+    return;
+  }
+
+  // Poll stats from HW. Counters are monotonic during the run: the interval
+  // deltas and rates are computed here against the previous snapshot.
+  m_iface_xstats.poll();
+  const uint64_t now_tsc = rte_rdtsc();
+  const double interval_s = double(now_tsc - m_last_opmon_tsc) / rte_get_tsc_hz();
+  m_last_opmon_tsc = now_tsc;
+  const double inv_s = (interval_s > 0) ? 1. / interval_s : 0.;
+
+  const auto& eth = m_iface_xstats.m_eth_stats;
   opmon::EthStats s;
-  s.set_ipackets( m_iface_xstats.m_eth_stats.ipackets );
-  s.set_opackets( m_iface_xstats.m_eth_stats.opackets );
-  s.set_ibytes( m_iface_xstats.m_eth_stats.ibytes );
-  s.set_obytes( m_iface_xstats.m_eth_stats.obytes );
-  s.set_imissed( m_iface_xstats.m_eth_stats.imissed );
-  s.set_ierrors( m_iface_xstats.m_eth_stats.ierrors );
-  s.set_oerrors( m_iface_xstats.m_eth_stats.oerrors );
-  s.set_rx_nombuf( m_iface_xstats.m_eth_stats.rx_nombuf );
+  s.set_ipackets( eth.ipackets );
+  s.set_opackets( eth.opackets );
+  s.set_ibytes( eth.ibytes );
+  s.set_obytes( eth.obytes );
+  s.set_imissed( eth.imissed );
+  s.set_ierrors( eth.ierrors );
+  s.set_oerrors( eth.oerrors );
+  s.set_rx_nombuf( eth.rx_nombuf );
   publish( std::move(s) );
 
-  // Poll stats from HW
-  m_iface_xstats.poll();
+  opmon::EthStatsRates r;
+  const uint64_t ipackets_delta = counter_delta(eth.ipackets, m_prev_eth_stats.ipackets);
+  r.set_ipackets_per_s( ipackets_delta * inv_s );
+  r.set_opackets_per_s( counter_delta(eth.opackets, m_prev_eth_stats.opackets) * inv_s );
+  const uint64_t ibytes_delta = counter_delta(eth.ibytes, m_prev_eth_stats.ibytes);
+  r.set_ibytes_per_s( ibytes_delta * inv_s );
+  r.set_obytes_per_s( counter_delta(eth.obytes, m_prev_eth_stats.obytes) * inv_s );
+  const uint64_t imissed_delta = counter_delta(eth.imissed, m_prev_eth_stats.imissed);
+  r.set_imissed_per_s( imissed_delta * inv_s );
+  r.set_ierrors_per_s( counter_delta(eth.ierrors, m_prev_eth_stats.ierrors) * inv_s );
+  r.set_oerrors_per_s( counter_delta(eth.oerrors, m_prev_eth_stats.oerrors) * inv_s );
+  r.set_rx_nombuf_per_s( counter_delta(eth.rx_nombuf, m_prev_eth_stats.rx_nombuf) * inv_s );
+  r.set_interval_s( interval_s );
+  publish( std::move(r) );
+
+  opmon::PortConfig pc;
+  pc.set_mtu( m_applied_mtu );
+  pc.set_rx_offloads_requested( m_rx_offloads );
+  pc.set_rx_offloads_applied( m_applied_rx_offloads );
+  pc.set_rx_vector_path( m_rx_vector_path );
+  pc.set_tx_vector_path( m_tx_vector_path );
+  pc.set_rx_burst_mode( m_rx_burst_mode );
+  pc.set_tx_burst_mode( m_tx_burst_mode );
+  publish( std::move(pc) );
+
+  // Link speed, also the frame cost budget of the sources fed by this link
+  struct rte_eth_link link;
+  if (rte_eth_link_get_nowait(m_iface_id, &link) == 0) {
+    m_link_speed_mbps = (link.link_status && link.link_speed != RTE_ETH_SPEED_NUM_UNKNOWN) ? link.link_speed : 0;
+  }
 
-  // loop over all the xstats information
-  opmon::EthXStatsInfo xinfos;
-  opmon::EthXStatsErrors xerrs;
-  std::map<std::string, opmon::QueueEthXStats> xq;
+  // Link state and recovery
+  {
+    const uint64_t down_since = m_link_down_since_tsc.load();
+    const uint64_t ongoing_ns = down_since ? (now_tsc - down_since) * m_ns_per_tsc_cycle : 0;
+    uint64_t recovery_packets = 0;
+    for (const auto& [lcore, stats] : m_lcore_stats) {
+      recovery_packets += stats.recovery_packets.load(std::memory_order_relaxed);
+    }
+    opmon::LinkState ls;
+    ls.set_up( m_link_up.load() );
+    ls.set_lsc_interrupt( m_lsc_intr );
+    ls.set_down_events( m_link_down_events.load() );
+    ls.set_downtime_ms( (m_link_downtime_ns.load() + ongoing_ns) / 1000000 );
+    ls.set_current_downtime_ms( ongoing_ns / 1000000 );
+    ls.set_last_downtime_ms( m_link_last_down_ns.load() / 1000000 );
+    ls.set_longest_downtime_ms( std::max(m_link_longest_down_ns.load(), ongoing_ns) / 1000000 );
+    ls.set_lsc_interrupts( m_lsc_interrupts.load() );
+    ls.set_reset_events( m_reset_events.load() );
+    ls.set_port_resets( m_port_resets.load() );
+    ls.set_failed_resets( m_failed_resets.load() );
+    ls.set_frames_during_recovery( recovery_packets );
+    publish( std::move(ls) );
+  }
 
-  for (int i = 0; i < m_iface_xstats.m_len; ++i) {
-    
-    std::string name(m_iface_xstats.m_xstats_names[i].name);
-    
-    // first we select the info from the queue
-    static std::regex queue_regex(R"((rx|tx)_q(\d+)_([^_]+))");
-    std::smatch match;
-    
-    if ( std::regex_match(name, match, queue_regex) ) {
-      auto queue_name = match[1].str() + '-' + match[2].str();
-      auto & entry = xq[queue_name];
-      try {
-	opmonlib::set_value( entry, match[3], m_iface_xstats.m_xstats_values[i] );
-      } catch ( const ers::Issue & e ) {
-	ers::warning( MetricPublishFailed( ERS_HERE, name, e) );
+  // Worst sink among the sources of this interface, from their previous interval
+  opmon::SlowestConsumer sc;
+  for (const auto& [rx_q, streams] : m_stream_id_to_source_id) {
+    for (const auto& [stream_id, sid] : streams) {
+      auto src_it = m_sources.find(sid);
+      if (src_it == m_sources.end()) {
+        continue;
       }
-      continue;
-    } 
+      src_it->second->set_line_rate_mbps( m_link_speed_mbps );
+      const uint64_t cost_ns = src_it->second->get_consumer_cost_ns();
+      if (cost_ns > sc.cost_ns()) {
+        sc.set_source_id( sid );
+        sc.set_queue( rx_q );
+        sc.set_cost_ns( cost_ns );
+      }
+    }
+  }
+  publish( std::move(sc) );
 
-    google::protobuf::Message * metric_p = nullptr;
-    static std::regex err_regex(R"(.+error.*)");
-    if ( std::regex_match( name, err_regex ) ) metric_p = & xerrs;
-    else  metric_p = & xinfos;
-    
-    try { 
-      opmonlib::set_value(*metric_p, name, m_iface_xstats.m_xstats_values[i]);
-    } catch ( const ers::Issue & e ) {
-      ers::warning( MetricPublishFailed( ERS_HERE, name, e) );
+  // Follow the NIC clock drift
+  if (m_hw_timestamps) {
+    calibrate_nic_clock();
+  }
+
+  // PAUSE frame rates, next to the imissed rate of the same interval
+  std::array<double, s_num_pause_stats> pause_rates{};
+  for (int p = 0; p < s_num_pause_stats; ++p) {
+    if (m_pause_xstat_idx[p] >= 0) {
+      pause_rates[p] = counter_delta(m_iface_xstats.m_xstats_values[m_pause_xstat_idx[p]], m_pause_xstat_prev[p]) * inv_s;
     }
-    
-  } // loop over xstats
-  
-  // Reset HW counters
-  m_iface_xstats.reset_counters();
-  
+  }
+  opmon::PauseFrameRates pr;
+  pr.set_rx_xon_per_s( pause_rates[0] );
+  pr.set_rx_xoff_per_s( pause_rates[1] );
+  pr.set_tx_xon_per_s( pause_rates[2] );
+  pr.set_tx_xoff_per_s( pause_rates[3] );
+  pr.set_imissed_per_s( imissed_delta * inv_s );
+  publish( std::move(pr) );
+
+  // Fill the precomputed fields of the published xstats
+  opmon::EthXStatsInfo xinfos;
+  opmon::EthXStatsErrors xerrs;
+  std::vector<opmon::QueueEthXStats> xq(m_xstat_queue_labels.size());
+
+  for (const auto& target : m_xstat_targets) {
+    google::protobuf::Message* metric_p = nullptr;
+    switch (target.group) {
+      case XstatGroup::kQueue:  metric_p = &xq[target.queue]; break;
+      case XstatGroup::kErrors: metric_p = &xerrs; break;
+      default:                  metric_p = &xinfos; break;
+    }
+    metric_p->GetReflection()->SetUInt64(metric_p, target.field, m_iface_xstats.m_xstats_values[target.idx]);
+  }
+
   // finally we publish the information
   publish( std::move(xinfos) );
   publish( std::move(xerrs) );
-  for ( auto [id, stat] : xq ) {
-    publish( std::move(stat), {{"queue", id}} );
+  for ( std::size_t q = 0; q < xq.size(); ++q ) {
+    publish( std::move(xq[q]), {{"queue", m_xstat_queue_labels[q]}} );
   }
+
+  // Cost of the HW stats part of this cycle, to keep an eye on the opmon overhead
+  opmon::OpmonCycleCost cost;
+  cost.set_xstats_cycle_us( std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - cycle_start).count() );
+  dpdklibs_trace_opmon_poll(m_iface_id, now_tsc, cost.xstats_cycle_us());
+  cost.set_xstats_polled( m_iface_xstats.m_num_selected );
+  cost.set_xstats_published( m_xstat_targets.size() );
+  publish( std::move(cost) );
   
+  for (const auto& [rx_q, mtr_id] : m_rxq_meters) {
+    struct rte_mtr_stats mtr_stats;
+    uint64_t stats_mask = 0;
+    struct rte_mtr_error mtr_error;
+    if (rte_mtr_stats_read(m_iface_id, mtr_id, &mtr_stats, &stats_mask, 0, &mtr_error) != 0) {
+      continue;
+    }
+    const std::string& src_ip = m_rxq_to_ip[rx_q];
+    auto& prev = m_prev_meter_stats[rx_q];
+    const uint64_t dropped_delta = counter_delta(mtr_stats.n_pkts_dropped, prev.dropped_packets);
+    opmon::SenderPolicing p;
+    p.set_green_packets( mtr_stats.n_pkts[RTE_COLOR_GREEN] );
+    p.set_yellow_packets( mtr_stats.n_pkts[RTE_COLOR_YELLOW] );
+    p.set_dropped_packets( mtr_stats.n_pkts_dropped );
+    p.set_dropped_bytes( mtr_stats.n_bytes_dropped );
+    p.set_dropped_packets_per_s( dropped_delta * inv_s );
+    publish( std::move(p), {{"queue", std::to_string(rx_q)}, {"sender", src_ip}} );
+
+    // Once when the sender starts being policed, again after a cycle without drops
+    if (dropped_delta > 0 && !prev.policed) {
+      ers::warning(SenderPoliced(ERS_HERE, src_ip, m_iface_id, dropped_delta));
+    }
+    prev.policed = dropped_delta > 0;
+  }
+
+  // Capacity of the interface: tightest lcore and mbuf pool, filled below
+  opmon::CapacityInfo cap;
+  cap.set_lcore_headroom_pct( 100. );
+  cap.set_busiest_lcore( -1 );
+  cap.set_mempool_headroom_pct( 100. );
+  cap.set_tightest_mempool_queue( -1 );
+
   for( const auto& [src_rx_q,_] : m_num_frames_rxq) {
     opmon::QueueInfo i;
     i.set_packets_received( m_num_frames_rxq[src_rx_q].load() );
     i.set_bytes_received( m_num_bytes_rxq[src_rx_q].load() );
     i.set_full_rx_burst( m_num_full_bursts[src_rx_q].load() );
     i.set_max_burst_size( m_max_burst_size[src_rx_q].exchange(0) );
+    i.set_packets_per_s( counter_delta(i.packets_received(), m_prev_frames_rxq[src_rx_q]) * inv_s );
+    i.set_bytes_per_s( counter_delta(i.bytes_received(), m_prev_bytes_rxq[src_rx_q]) * inv_s );
+    i.set_work_cycles( m_work_cycles_rxq[src_rx_q].load() );
+
+    {
+      LatencyHistogram::counts_t interval;
+      auto& hist = m_latency_rxq[src_rx_q];
+      hist.delta(m_prev_latency_rxq[src_rx_q], interval);
+      opmon::LatencyInfo l;
+      l.set_p50_ns( LatencyHistogram::percentile(interval, 0.5) );
+      l.set_p99_ns( LatencyHistogram::percentile(interval, 0.99) );
+      l.set_p999_ns( LatencyHistogram::percentile(interval, 0.999) );
+      l.set_max_ns( hist.max.exchange(0) );
+      l.set_hw_timestamps( m_hw_timestamps );
+      publish( std::move(l), {{"queue", std::to_string(src_rx_q)}} );
+    }
+
+    {
+      auto& occ = m_ring_occupancy_rxq[src_rx_q];
+      auto& [prev_sum, prev_samples] = m_prev_ring_occupancy_rxq[src_rx_q];
+      const uint64_t sum = counter_delta(occ.sum.load(std::memory_order_relaxed), prev_sum);
+      const uint64_t samples = counter_delta(occ.samples.load(std::memory_order_relaxed), prev_samples);
+      i.set_ring_occupancy_max( occ.max.exchange(0) );
+      i.set_ring_occupancy_mean( samples ? double(sum) / samples : 0. );
+      i.set_ring_size( m_rx_ring_size );
+    }
+
+    // Free mbufs of the queue's pool, cache contents included
+    auto pool_it = m_mbuf_pools.find(src_rx_q);
+    if (pool_it != m_mbuf_pools.end()) {
+      const uint32_t avail = rte_mempool_avail_count(pool_it->second.get());
+      const uint32_t size = pool_it->second->size;
+      i.set_mempool_avail( avail );
+      i.set_mempool_size( size );
+      const double headroom_pct = size ? 100. * avail / size : 0.;
+      if (headroom_pct < cap.mempool_headroom_pct()) {
+        cap.set_mempool_headroom_pct( headroom_pct );
+        cap.set_tightest_mempool_queue( src_rx_q );
+      }
+    }
+
+    // Poll gaps over the interval, against the time the RX ring lasts at the current rate
+    {
+      auto& hist = m_poll_gap_rxq[src_rx_q];
+      auto& prev = m_prev_poll_gap_rxq[src_rx_q];
+      opmon::PollGapHistogram h;
+      const auto* desc = h.GetDescriptor();
+      for (int b = 0; b < PollGapHistogram::s_num_bins; ++b) {
+        h.GetReflection()->SetUInt64(&h, desc->field(b), counter_delta(hist.bins[b].load(std::memory_order_relaxed), prev[b]));
+      }
+      const uint64_t max_gap_ns = hist.max_gap_ns.exchange(0);
+      h.set_max_gap_us( max_gap_ns / 1000 );
+      h.set_imissed_in_interval( imissed_delta );
+      publish( std::move(h), {{"queue", std::to_string(src_rx_q)}, {"lcore", std::to_string(m_rxq_to_lcore[src_rx_q])}} );
+
+      // Raised when the queue enters the condition, not on every interval it lasts
+      bool exceeded = false;
+      if (i.packets_per_s() > 0) {
+        const uint64_t ring_time_ns = m_rx_ring_size * 1e9 / i.packets_per_s();
+        exceeded = max_gap_ns > ring_time_ns;
+        if (exceeded && !m_poll_gap_exceeded_rxq[src_rx_q]) {
+          ers::warning(PollGapExceedsRing(ERS_HERE, m_rxq_to_lcore[src_rx_q], m_iface_id, src_rx_q,
+                                          max_gap_ns / 1000, ring_time_ns / 1000, imissed_delta));
+        }
+      }
+      m_poll_gap_exceeded_rxq[src_rx_q] = exceeded;
+    }
+    i.set_cksum_bad( m_num_cksum_bad_rxq[src_rx_q].load() );
+    i.set_cksum_unknown( m_num_cksum_unknown_rxq[src_rx_q].load() );
+    i.set_cksum_dropped( m_num_cksum_dropped_rxq[src_rx_q].load() );
+
+    if (m_cksum_policy == ChecksumPolicy::kTag) {
+      auto bad = m_num_cksum_bad_rxq[src_rx_q].load();
+      if (bad > m_last_cksum_bad_rxq[src_rx_q]) {
+        ers::warning(BadChecksumFrames(ERS_HERE, m_iface_id, src_rx_q, m_rxq_to_ip[src_rx_q], bad - m_last_cksum_bad_rxq[src_rx_q]));
+      }
+      m_last_cksum_bad_rxq[src_rx_q] = bad;
+    }
     
     publish( std::move(i), {{"queue", std::to_string(src_rx_q)}} );
   }
+
+  // Per stream rates and silence, rolled up per sender
+  struct SenderTotals
+  {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    uint64_t lost_frames = 0;
+    uint64_t seq_id_gaps = 0;
+    uint32_t streams = 0;
+    uint32_t silent_streams = 0;
+  };
+  std::map<int, SenderTotals> senders;
+  for (std::size_t slot = 0; slot < m_slots.size(); ++slot) {
+    const auto& ss = m_slots[slot];
+    auto& prev = m_prev_stream_counters[slot];
+    const uint64_t frames = counter_delta(m_stream_counters[slot].frames.load(std::memory_order_relaxed), prev.frames);
+    const uint64_t bytes = counter_delta(m_stream_counters[slot].bytes.load(std::memory_order_relaxed), prev.bytes);
+    const uint64_t seen_tsc = std::max(m_last_seen_tsc[slot].load(std::memory_order_relaxed), m_flow_enabled_tsc.load());
+    const double silent_s = now_tsc > seen_tsc ? double(now_tsc - seen_tsc) / rte_get_tsc_hz() : 0.;
+
+    opmon::StreamInfo si;
+    si.set_frames( prev.frames );
+    si.set_bytes( prev.bytes );
+    si.set_packets_per_s( frames * inv_s );
+    si.set_bytes_per_s( bytes * inv_s );
+    si.set_silent_s( silent_s );
+    si.set_silent( m_stream_silence_timeout_ms && m_lcore_enable_flow.load() && silent_s * 1000 > m_stream_silence_timeout_ms );
+    publish( std::move(si), {{"queue", std::to_string(ss.rx_q)}, {"stream", std::to_string(ss.stream_id)}, {"source_id", std::to_string(ss.source_id)}} );
+
+    auto& st = senders[ss.rx_q];
+    st.frames += frames;
+    st.bytes += bytes;
+    st.lost_frames += m_continuity[slot].lost_frames.load(std::memory_order_relaxed);
+    st.seq_id_gaps += m_continuity[slot].seq_id_gaps.load(std::memory_order_relaxed);
+    ++st.streams;
+    st.silent_streams += (frames == 0);
+  }
+  for (const auto& [rx_q, st] : senders) {
+    opmon::SenderInfo si;
+    si.set_packets_per_s( st.frames * inv_s );
+    si.set_bytes_per_s( st.bytes * inv_s );
+    si.set_lost_frames( st.lost_frames );
+    si.set_seq_id_gaps( st.seq_id_gaps );
+    si.set_streams( st.streams );
+    si.set_silent_streams( st.silent_streams );
+    publish( std::move(si), {{"queue", std::to_string(rx_q)}, {"sender", m_rxq_to_ip[rx_q]}} );
+  }
+
+  opmon::StreamWatchdog sw;
+  sw.set_timeout_ms( m_stream_silence_timeout_ms );
+  sw.set_silent_streams( m_silent_streams.load() );
+  sw.set_silence_events( m_silence_events.load() );
+  publish( std::move(sw) );
+
+  // Unexpected streams, with at most one warning per sender/stream every m_unexpected_warning_interval_s
+  const uint64_t warning_interval_tsc = uint64_t(m_unexpected_warning_interval_s) * rte_get_tsc_hz();
+  for (auto& [rx_q, counts] : m_unexpected_rxq) {
+    auto& prevs = m_prev_unexpected_rxq[rx_q];
+    for (int stream_id = 0; stream_id < s_num_stream_ids; ++stream_id) {
+      const uint64_t frames = counts[stream_id].load(std::memory_order_relaxed);
+      if (frames == 0) {
+        continue;
+      }
+      auto& prev = prevs[stream_id];
+      const uint64_t new_frames = counter_delta(frames, prev.frames);
+
+      opmon::UnexpectedStreamInfo ui;
+      ui.set_frames( frames );
+      ui.set_frames_per_s( new_frames * inv_s );
+      publish( std::move(ui), {{"queue", std::to_string(rx_q)}, {"stream", std::to_string(stream_id)}, {"sender", m_rxq_to_ip[rx_q]}} );
+
+      if (frames > prev.warned_frames && now_tsc - prev.warned_tsc >= warning_interval_tsc) {
+        ers::warning(UnexpectedStreamFrames(ERS_HERE, m_iface_id, rx_q, m_rxq_to_ip[rx_q], stream_id, frames - prev.warned_frames));
+        prev.warned_frames = frames;
+        prev.warned_tsc = now_tsc;
+      }
+    }
+  }
+
+  // Stream continuity, cumulative over the run with maxima over the interval
+  if (m_continuity_check_stride) {
+    for (std::size_t slot = 0; slot < m_slots.size(); ++slot) {
+      const auto& ss = m_slots[slot];
+      auto& c = m_continuity[slot];
+      opmon::StreamContinuityInfo ci;
+      ci.set_pairs_checked( c.pairs_checked.load(std::memory_order_relaxed) );
+      ci.set_seq_id_gaps( c.seq_id_gaps.load(std::memory_order_relaxed) );
+      ci.set_lost_frames( c.lost_frames.load(std::memory_order_relaxed) );
+      ci.set_max_seq_id_skip( c.max_seq_id_skip.exchange(0) );
+      ci.set_timestamp_anomalies( c.timestamp_anomalies.load(std::memory_order_relaxed) );
+      ci.set_max_timestamp_deviation( c.max_timestamp_deviation.exchange(0) );
+      publish( std::move(ci), {{"queue", std::to_string(ss.rx_q)}, {"stream", std::to_string(ss.stream_id)}, {"source_id", std::to_string(ss.source_id)}} );
+    }
+  }
+
+  for (auto& [lcore, stats] : m_lcore_stats) {
+    auto& prev = m_prev_lcore_stats[lcore];
+    const uint64_t busy = counter_delta(stats.busy_cycles.load(std::memory_order_relaxed), prev.busy_cycles);
+    const uint64_t idle = counter_delta(stats.idle_cycles.load(std::memory_order_relaxed), prev.idle_cycles);
+    const uint64_t sleep = counter_delta(stats.sleep_cycles.load(std::memory_order_relaxed), prev.sleep_cycles);
+    const uint64_t empty_polls = counter_delta(stats.empty_polls.load(std::memory_order_relaxed), prev.empty_polls);
+    const uint64_t polls = counter_delta(stats.polls.load(std::memory_order_relaxed), prev.polls);
+    const uint64_t packets = counter_delta(stats.packets.load(std::memory_order_relaxed), prev.packets);
+    const uint64_t total = busy + idle + sleep;
+
+    opmon::LcoreInfo li;
+    li.set_utilization_pct( total ? 100. * busy / total : 0. );
+    if (total && 100. - li.utilization_pct() < cap.lcore_headroom_pct()) {
+      cap.set_lcore_headroom_pct( 100. - li.utilization_pct() );
+      cap.set_busiest_lcore( lcore );
+    }
+    li.set_sleep_pct( total ? 100. * sleep / total : 0. );
+    li.set_cycles_per_packet( packets ? double(busy) / packets : 0. );
+    li.set_empty_polls( empty_polls );
+    li.set_polls( polls );
+    li.set_packets( packets );
+    publish( std::move(li), {{"lcore", std::to_string(lcore)}} );
+
+    // Hardware counters, only from the lcores that could open some
+    auto& perf = m_lcore_perf[lcore];
+    const uint32_t available = perf.available.load(std::memory_order_relaxed);
+    if (!available) {
+      continue;
+    }
+    auto& prev_perf = m_prev_lcore_perf[lcore];
+    PerfCounters::counts_t d;
+    for (int e = 0; e < PerfCounters::s_num_events; ++e) {
+      d[e] = counter_delta(perf.counts[e].load(std::memory_order_relaxed), prev_perf.counts[e]);
+    }
+    const uint64_t perf_packets = counter_delta(perf.packets.load(std::memory_order_relaxed), prev_perf.packets);
+    auto per_packet = [perf_packets](uint64_t v) { return perf_packets ? double(v) / perf_packets : 0.; };
+
+    opmon::LcorePerfInfo pi;
+    pi.set_available_mask( available );
+    pi.set_cycles( d[PerfCounters::kCycles] );
+    pi.set_instructions( d[PerfCounters::kInstructions] );
+    pi.set_llc_misses( d[PerfCounters::kLLCMisses] );
+    pi.set_dtlb_misses( d[PerfCounters::kDTLBMisses] );
+    pi.set_packets( perf_packets );
+    pi.set_ipc( d[PerfCounters::kCycles] ? double(d[PerfCounters::kInstructions]) / d[PerfCounters::kCycles] : 0. );
+    pi.set_instructions_per_packet( per_packet(d[PerfCounters::kInstructions]) );
+    pi.set_llc_misses_per_packet( per_packet(d[PerfCounters::kLLCMisses]) );
+    pi.set_dtlb_misses_per_packet( per_packet(d[PerfCounters::kDTLBMisses]) );
+    publish( std::move(pi), {{"lcore", std::to_string(lcore)}} );
+  }
+
+  // Received rate against the negotiated speed. ibytes doesn't count the
+  // CRC (stripped), the preamble and the inter-frame gap: 24 bytes per frame on the wire.
+  const double rx_bits_per_s = ibytes_delta * 8 * inv_s;
+  const double wire_bits_per_s = (ibytes_delta + ipackets_delta * 24) * 8 * inv_s;
+  cap.set_link_speed_mbps( m_link_speed_mbps );
+  cap.set_rx_bits_per_s( rx_bits_per_s );
+  cap.set_link_utilization_pct( m_link_speed_mbps ? rx_bits_per_s / (m_link_speed_mbps * 1e4) : 0. );
+  cap.set_wire_utilization_pct( m_link_speed_mbps ? wire_bits_per_s / (m_link_speed_mbps * 1e4) : 0. );
+  publish( std::move(cap) );
+}
+
+//-----------------------------------------------------------------------------
+bool
+IfaceWrapper::start_capture(CaptureRequest req, const std::string& sender)
+{
+  if (!sender.empty()) {
+    req.rx_q = -2;
+    for (const auto& [rx_q, src_ip] : m_rxq_to_ip) {
+      if (src_ip == sender) {
+        req.rx_q = rx_q;
+      }
+    }
+    if (req.rx_q == -2) {
+      TLOG() << "Iface[" << m_iface_id << "] has no queue for sender " << sender << ", capture not started";
+      return false;
+    }
+  } else if (req.rx_q >= 0 && m_rx_qs.count(req.rx_q) == 0) {
+    TLOG() << "Iface[" << m_iface_id << "] has no RX queue " << req.rx_q << ", capture not started";
+    return false;
+  }
+  return m_capture->arm(req);
+}
+
+//-----------------------------------------------------------------------------
+void
+IfaceWrapper::setup_stats_zone()
+{
+  const std::string name = statszone::memzone_name(m_iface_id);
+  if (m_stats_zone == nullptr) {
+    m_stats_zone = rte_memzone_lookup(name.c_str());
+  }
+  if (m_stats_zone == nullptr) {
+    m_stats_zone = rte_memzone_reserve_aligned(name.c_str(), sizeof(statszone::Zone), m_socket_id, 0, RTE_CACHE_LINE_SIZE);
+  }
+  if (m_stats_zone == nullptr) {
+    TLOG() << "Iface[" << m_iface_id << "] could not reserve memzone " << name << ": " << rte_strerror(rte_errno);
+    return;
+  }
+
+  // Static part of the block; the counters are refreshed by the monitor thread
+  auto* zone = static_cast<statszone::Zone*>(m_stats_zone->addr);
+  std::memset(static_cast<void*>(zone), 0, sizeof(statszone::Zone));
+  auto& h = zone->header;
+  h.version = statszone::s_version;
+  h.iface_id = m_iface_id;
+  h.tsc_hz = rte_get_tsc_hz();
+  uint32_t nq = 0;
+  for (const auto& rx_q : m_rx_qs) {
+    if (nq == statszone::s_max_queues) {
+      break;
+    }
+    auto& q = zone->queues[nq++];
+    q.rx_q = rx_q;
+    q.lcore = m_rxq_to_lcore[rx_q];
+    std::strncpy(q.src_ip, m_rxq_to_ip[rx_q].c_str(), sizeof(q.src_ip) - 1);
+  }
+  h.num_queues = nq;
+  h.num_streams = std::min<std::size_t>(m_slots.size(), statszone::s_max_streams);
+  for (uint32_t slot = 0; slot < h.num_streams; ++slot) {
+    zone->streams[slot].rx_q = m_slots[slot].rx_q;
+    zone->streams[slot].stream_id = m_slots[slot].stream_id;
+    zone->streams[slot].source_id = m_slots[slot].source_id;
+  }
+  uint32_t nl = 0;
+  for (const auto& [lcore, _] : m_lcore_stats) {
+    if (nl == statszone::s_max_lcores) {
+      break;
+    }
+    zone->lcores[nl++].lcore = lcore;
+  }
+  h.num_lcores = nl;
+  // Readers check the magic last
+  std::atomic_thread_fence(std::memory_order_release);
+  h.magic = statszone::s_magic;
+  TLOG() << "Iface[" << m_iface_id << "] publishes its stats in memzone " << name;
+}
+
+//-----------------------------------------------------------------------------
+void
+IfaceWrapper::update_stats_zone(const struct rte_eth_stats* eth)
+{
+  auto* zone = static_cast<statszone::Zone*>(m_stats_zone->addr);
+  auto& h = zone->header;
+  h.seq.fetch_add(1, std::memory_order_acq_rel);
+  h.update_tsc = rte_rdtsc();
+  if (eth != nullptr) {
+    h.imissed = eth->imissed;
+    h.rx_nombuf = eth->rx_nombuf;
+  }
+  for (uint32_t i = 0; i < h.num_queues; ++i) {
+    auto& q = zone->queues[i];
+    q.packets = m_num_frames_rxq[q.rx_q].load(std::memory_order_relaxed);
+    q.bytes = m_num_bytes_rxq[q.rx_q].load(std::memory_order_relaxed);
+    q.full_bursts = m_num_full_bursts[q.rx_q].load(std::memory_order_relaxed);
+    q.work_cycles = m_work_cycles_rxq[q.rx_q].load(std::memory_order_relaxed);
+    q.cksum_bad = m_num_cksum_bad_rxq[q.rx_q].load(std::memory_order_relaxed);
+  }
+  for (uint32_t slot = 0; slot < h.num_streams; ++slot) {
+    auto& st = zone->streams[slot];
+    st.frames = m_stream_counters[slot].frames.load(std::memory_order_relaxed);
+    st.bytes = m_stream_counters[slot].bytes.load(std::memory_order_relaxed);
+    st.lost_frames = m_continuity[slot].lost_frames.load(std::memory_order_relaxed);
+    st.seq_id_gaps = m_continuity[slot].seq_id_gaps.load(std::memory_order_relaxed);
+    st.sink_dropped = m_slots[slot].source ? m_slots[slot].source->get_dropped_frames() : 0;
+  }
+  for (uint32_t i = 0; i < h.num_lcores; ++i) {
+    auto& l = zone->lcores[i];
+    const auto& stats = m_lcore_stats[l.lcore];
+    l.busy_cycles = stats.busy_cycles.load(std::memory_order_relaxed);
+    l.idle_cycles = stats.idle_cycles.load(std::memory_order_relaxed);
+    l.sleep_cycles = stats.sleep_cycles.load(std::memory_order_relaxed);
+    l.polls = stats.polls.load(std::memory_order_relaxed);
+    l.packets = stats.packets.load(std::memory_order_relaxed);
+  }
+  h.seq.fetch_add(1, std::memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+void
+IfaceWrapper::monitor_func()
+{
+  uint64_t prev_imissed = UINT64_MAX;
+  while (m_run_marker.load()) {
+    if (m_link_recovery_enabled) {
+      follow_link_state();
+    }
+    if (m_stream_silence_timeout_ms) {
+      watch_streams();
+    }
+
+    struct rte_eth_stats eth;
+    const bool eth_ok = rte_eth_stats_get(m_iface_id, &eth) == 0;
+
+    if (m_stats_zone != nullptr) {
+      update_stats_zone(eth_ok ? &eth : nullptr);
+    }
+
+    if (m_flight_recorder_enabled) {
+      // HW drops in the last period freeze every lcore of the interface, at their next record
+      if (eth_ok && prev_imissed != UINT64_MAX && m_flight_imissed_trigger &&
+          eth.imissed >= prev_imissed + m_flight_imissed_trigger) {
+        const uint64_t now_tsc = rte_rdtsc();
+        for (auto& [lcore, fr] : m_flight_recorders) {
+          fr.request_freeze(FlightTrigger::kImissed, now_tsc, eth.imissed - prev_imissed);
+        }
+      }
+      dump_flight_recorders();
+    }
+    if (eth_ok) {
+      prev_imissed = eth.imissed;
+    }
+
+    if (m_run_report_enabled) {
+      sample_run_report();
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(m_monitor_period_ms));
+  }
+}
+
+//-----------------------------------------------------------------------------
+void
+IfaceWrapper::dump_flight_recorders()
+{
+  for (auto& [lcore, fr] : m_flight_recorders) {
+    // Acquire: the ring and the trigger fields were written before the lcore froze
+    const uint32_t trigger = fr.frozen.load(std::memory_order_acquire);
+    if (!trigger) {
+      continue;
+    }
+    if (m_flight_dumps < m_flight_max_dumps) {
+      const std::string file = fmt::format("{}/dpdklibs_flight_iface{}_lcore{}_{}.bin", m_flight_dump_dir, m_iface_id, lcore, fr.trigger_tsc);
+      std::ofstream out(file, std::ios::binary);
+      if (out) {
+        fr.dump(out, m_iface_id, lcore, rte_get_tsc_hz());
+        ++m_flight_dumps;
+        TLOG() << "Iface[" << m_iface_id << "] lcore " << lcore << " flight recorder dumped to " << file
+               << " (trigger " << trigger << ", value " << fr.trigger_value << ")";
+      } else {
+        TLOG() << "Iface[" << m_iface_id << "] can't write flight recorder dump " << file;
+      }
+      if (m_flight_dumps == m_flight_max_dumps) {
+        TLOG() << "Iface[" << m_iface_id << "] reached " << m_flight_max_dumps << " flight recorder dumps, no more this run";
+      }
+    }
+    fr.thaw();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void
+IfaceWrapper::watch_streams()
+{
+  if (!m_lcore_enable_flow.load()) {
+    return;
+  }
+  // New run: streams are watched from the time the flow was enabled
+  const uint64_t since = m_flow_enabled_tsc.load();
+  if (since != m_watch_since_tsc) {
+    m_watch_since_tsc = since;
+    m_slot_silent.assign(m_slots.size(), 0);
+  }
+
+  const uint64_t now_tsc = rte_rdtsc();
+  const uint64_t timeout_cycles = uint64_t(m_stream_silence_timeout_ms) * rte_get_tsc_hz() / 1000;
+  uint32_t silent_streams = 0;
+  for (std::size_t slot = 0; slot < m_slots.size(); ++slot) {
+    const uint64_t seen = std::max(m_last_seen_tsc[slot].load(std::memory_order_relaxed), since);
+    const bool silent = now_tsc > seen + timeout_cycles;
+    const auto& ss = m_slots[slot];
+    if (silent && !m_slot_silent[slot]) {
+      ++m_silence_events;
+      ers::warning(StreamSilent(ERS_HERE, m_iface_id, ss.rx_q, m_rxq_to_ip[ss.rx_q], ss.stream_id, ss.source_id,
+                                (now_tsc - seen) * m_ns_per_tsc_cycle / 1000000));
+    } else if (!silent && m_slot_silent[slot]) {
+      TLOG() << "Iface[" << m_iface_id << "] stream " << ss.stream_id << " (source " << ss.source_id
+             << ") from sender " << m_rxq_to_ip[ss.rx_q] << " resumed.";
+    }
+    m_slot_silent[slot] = silent;
+    silent_streams += silent;
+  }
+  m_silent_streams = silent_streams;
+}
+
+//-----------------------------------------------------------------------------
+int
+IfaceWrapper::eth_event_callback(uint16_t /*port_id*/, enum rte_eth_event_type type, void* cb_arg, void* /*ret_param*/)
+{
+  // EAL interrupt thread: the port can't be reset from here, only flag it
+  auto* self = static_cast<IfaceWrapper*>(cb_arg);
+  if (type == RTE_ETH_EVENT_INTR_LSC) {
+    self->m_lsc_event_tsc.store(rte_rdtsc());
+    ++self->m_lsc_interrupts;
+  } else if (type == RTE_ETH_EVENT_INTR_RESET) {
+    ++self->m_reset_events;
+    self->m_reset_requested.store(true);
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+void
+IfaceWrapper::follow_link_state()
+{
+  if (m_reset_requested.exchange(false)) {
+    TLOG() << "Iface[" << m_iface_id << "] reset requested by the PMD.";
+    reset_port();
+  }
+
+  struct rte_eth_link link;
+  if (rte_eth_link_get_nowait(m_iface_id, &link) != 0) {
+    return;
+  }
+  // The interrupt time is more precise than this period
+  const uint64_t now_tsc = rte_rdtsc();
+  const uint64_t lsc_tsc = m_lsc_event_tsc.load();
+  const uint64_t event_tsc = (lsc_tsc && now_tsc - lsc_tsc < uint64_t(m_monitor_period_ms) * rte_get_tsc_hz() / 1000) ? lsc_tsc : now_tsc;
+
+  const uint64_t reset_cycles = uint64_t(m_link_down_reset_ms) * rte_get_tsc_hz() / 1000;
+  if (m_link_up.load() && !link.link_status) {
+    m_link_up = false;
+    m_link_recovering = true;
+    m_link_down_since_tsc = event_tsc;
+    m_outage_resets = 0;
+    m_next_reset_tsc = event_tsc + reset_cycles;
+    ++m_link_down_events;
+    ers::warning(LinkDown(ERS_HERE, m_iface_id));
+  } else if (!m_link_up.load() && link.link_status) {
+    const uint64_t down_since = m_link_down_since_tsc.load();
+    const uint64_t down_ns = (event_tsc - down_since) * m_ns_per_tsc_cycle;
+    m_link_downtime_ns += down_ns;
+    m_link_last_down_ns = down_ns;
+    if (down_ns > m_link_longest_down_ns.load()) {
+      m_link_longest_down_ns = down_ns;
+    }
+    {
+      std::lock_guard<std::mutex> lk(m_link_mutex);
+      m_link_down_intervals.push_back({ std::chrono::system_clock::now() - std::chrono::nanoseconds(down_ns), down_ns / 1000000 });
+      if (m_link_down_intervals.size() > s_max_link_down_intervals) {
+        m_link_down_intervals.pop_front();
+      }
+    }
+    m_link_down_since_tsc = 0;
+    m_link_up = true;
+    // Switches may have aged out the MAC, announce it right away
+    send_garp();
+    m_link_recovering = false;
+    TLOG() << "Iface[" << m_iface_id << "] link back up at " << link.link_speed << " Mbps after " << down_ns / 1000000 << " ms.";
+  }
+
+  // Long outage: the port itself may be stuck, reset it once, then again
+  // with a doubling delay while the link stays down (a cable pulled out)
+  if (!m_link_up.load() && m_link_down_reset_ms && now_tsc >= m_next_reset_tsc) {
+    TLOG() << "Iface[" << m_iface_id << "] link down for " << (now_tsc - m_link_down_since_tsc.load()) * m_ns_per_tsc_cycle / 1000000
+           << " ms, resetting the port (attempt " << m_outage_resets + 1 << ").";
+    reset_port();
+    ++m_outage_resets;
+    const uint64_t backoff_ms = std::min<uint64_t>(uint64_t(m_link_down_reset_ms) << std::min(m_outage_resets, 16u),
+                                                   s_max_reset_backoff_ms);
+    m_next_reset_tsc = rte_rdtsc() + backoff_ms * rte_get_tsc_hz() / 1000;
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool
+IfaceWrapper::park_lcores()
+{
+  m_rx_paused.store(true);
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  for (const auto& [lcore, parked] : m_lcore_parked) {
+    while (!parked.load()) {
+      if (std::chrono::steady_clock::now() > deadline) {
+        m_rx_paused.store(false);
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool
+IfaceWrapper::reset_port()
+{
+  m_link_recovering = true;
+  std::lock_guard<std::mutex> port_lock(m_port_mutex);
+  std::lock_guard<std::mutex> garp_lock(m_garp_mutex);
+  if (!park_lcores()) {
+    ++m_failed_resets;
+    ers::warning(PortRecoveryFailed(ERS_HERE, m_iface_id, "RX lcores didn't park"));
+    m_link_recovering = !m_link_up.load();
+    return false;
+  }
+
+  // Reset, reconfiguration and restart, then the rules the reset wiped out.
+  // Neither step exits the process: failures are reported and retried later.
+  std::string failure;
+  try {
+    setup_interface();
+    if (install_flow_steering() != 0) {
+      failure = "flow rules couldn't be re-installed";
+    }
+  } catch (const ers::Issue& e) {
+    failure = e.message();
+  }
+
+  if (!failure.empty()) {
+    // The port may be left stopped: the lcores stay parked until a reset succeeds
+    ++m_failed_resets;
+    ers::warning(PortRecoveryFailed(ERS_HERE, m_iface_id, failure));
+    m_link_recovering = true;
+    return false;
+  }
+  m_rx_paused.store(false);
+  ++m_port_resets;
+  for (const auto& ip_addr_bin : m_ip_addr_bin) {
+    arp::pktgen_send_garp(m_garp_bufs[0][0], m_iface_id, ip_addr_bin);
+  }
+  ++m_garps_sent;
+  m_link_recovering = !m_link_up.load();
+  TLOG() << "Iface[" << m_iface_id << "] port reset, flows re-installed and GARP sent.";
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+runreport::Sample
+IfaceWrapper::collect_run_sample()
+{
+  runreport::Sample s;
+  s.tsc = rte_rdtsc();
+  struct rte_eth_stats eth;
+  if (rte_eth_stats_get(m_iface_id, &eth) == 0) {
+    s.port = { eth.imissed, eth.rx_nombuf, eth.ierrors };
+  }
+  s.queues.resize(m_rx_qs.size());
+  for (const auto& rx_q : m_rx_qs) {
+    auto& q = s.queues[rx_q];
+    q.frames = m_num_frames_rxq[rx_q].load(std::memory_order_relaxed);
+    q.cksum_bad = m_num_cksum_bad_rxq[rx_q].load(std::memory_order_relaxed);
+    q.cksum_dropped = m_num_cksum_dropped_rxq[rx_q].load(std::memory_order_relaxed);
+    for (const auto& c : m_unexpected_rxq[rx_q]) {
+      q.unexpected_frames += c.load(std::memory_order_relaxed);
+    }
+  }
+  s.streams.resize(m_slots.size());
+  for (std::size_t slot = 0; slot < m_slots.size(); ++slot) {
+    auto& st = s.streams[slot];
+    st.frames = m_stream_counters[slot].frames.load(std::memory_order_relaxed);
+    st.lost_frames = m_continuity[slot].lost_frames.load(std::memory_order_relaxed);
+    st.seq_id_gaps = m_continuity[slot].seq_id_gaps.load(std::memory_order_relaxed);
+    st.source_dropped = m_slots[slot].source != nullptr ? m_slots[slot].source->get_dropped_frames() : 0;
+  }
+  return s;
+}
+
+//-----------------------------------------------------------------------------
+void
+IfaceWrapper::begin_run_report(uint32_t run_number)
+{
+  if (!m_run_report_enabled) {
+    return;
+  }
+  std::lock_guard<std::mutex> lk(m_report_mutex);
+  m_report_run = run_number;
+  m_report_first = collect_run_sample();
+  m_report_start_time = std::chrono::system_clock::now();
+  m_report_last = m_report_first;
+  m_report_intervals = 0;
+  m_report_next_tsc = m_report_first.tsc + uint64_t(m_run_report_interval_ms) * rte_get_tsc_hz() / 1000;
+
+  std::vector<int> slot_queue;
+  for (const auto& ss : m_slots) {
+    slot_queue.push_back(ss.rx_q);
+  }
+  m_report_attr = std::make_unique<runreport::LossAttributor>(slot_queue);
+  for (auto& [rx_q, counts] : m_unexpected_rxq) {
+    auto& base = m_report_unexpected_base[rx_q];
+    for (int stream_id = 0; stream_id < s_num_stream_ids; ++stream_id) {
+      base[stream_id] = counts[stream_id].load(std::memory_order_relaxed);
+    }
+  }
+
+  m_report_file_base = fmt::format("{}/dpdklibs_run{}_iface{}", m_run_report_dir, m_report_run, m_iface_id);
+  m_report_series.close(); // left open by a run that was never ended
+  m_report_series.clear();
+  m_report_series.open(m_report_file_base + "_series.bin", std::ios::binary | std::ios::trunc);
+  if (m_report_series) {
+    runreport::SeriesHeader hdr{ runreport::SeriesHeader::s_magic, runreport::SeriesHeader::s_version, m_iface_id,
+                                 m_report_run, uint32_t(m_rx_qs.size()), uint32_t(m_slots.size()), rte_get_tsc_hz() };
+    runreport::write_series_header(m_report_series, hdr, slot_queue);
+    runreport::write_series_record(m_report_series, m_report_first);
+  } else {
+    TLOG() << "Iface[" << m_iface_id << "] can't write run report series " << m_report_file_base << "_series.bin";
+  }
+  m_report_active = true;
+}
+
+//-----------------------------------------------------------------------------
+void
+IfaceWrapper::sample_run_report()
+{
+  std::lock_guard<std::mutex> lk(m_report_mutex);
+  if (!m_report_active || rte_rdtsc() < m_report_next_tsc) {
+    return;
+  }
+  m_report_next_tsc += uint64_t(m_run_report_interval_ms) * rte_get_tsc_hz() / 1000;
+  auto s = collect_run_sample();
+  m_report_attr->add_interval(m_report_last, s);
+  if (m_report_series) {
+    runreport::write_series_record(m_report_series, s);
+  }
+  m_report_last = std::move(s);
+  ++m_report_intervals;
+}
+
+//-----------------------------------------------------------------------------
+void
+IfaceWrapper::end_run_report()
+{
+  std::lock_guard<std::mutex> lk(m_report_mutex);
+  if (!m_report_active) {
+    return;
+  }
+  // Last, partial interval
+  auto s = collect_run_sample();
+  m_report_attr->add_interval(m_report_last, s);
+  if (m_report_series) {
+    runreport::write_series_record(m_report_series, s);
+  }
+  m_report_last = std::move(s);
+  ++m_report_intervals;
+  m_report_series.close();
+
+  write_run_report();
+  m_report_active = false;
+}
+
+//-----------------------------------------------------------------------------
+void
+IfaceWrapper::write_run_report()
+{
+  using runreport::LossAttributor;
+  const auto& first = m_report_first;
+  const auto& last = m_report_last;
+  auto loss_json = [](const runreport::Attribution& a) {
+    return nlohmann::json{ { "checksum", a.checksum }, { "imissed", a.imissed }, { "rx_nombuf", a.rx_nombuf }, { "upstream", a.upstream } };
+  };
+
+  nlohmann::json j;
+  j["iface"] = m_iface_id;
+  j["run"] = m_report_run;
+  j["duration_s"] = double(last.tsc - first.tsc) / rte_get_tsc_hz();
+  j["interval_ms"] = m_run_report_interval_ms;
+  j["intervals"] = m_report_intervals;
+  j["series"] = m_report_file_base + "_series.bin";
+  j["attribution"] = "per interval, the lost frames of a stream are charged to the checksum drops of its queue, "
+                     "then to the port imissed and rx_nombuf, the rest upstream of the NIC";
+
+  const auto& unattributed = m_report_attr->unattributed();
+  j["port"] = { { "imissed", LossAttributor::delta(last.port.imissed, first.port.imissed) },
+                { "rx_nombuf", LossAttributor::delta(last.port.rx_nombuf, first.port.rx_nombuf) },
+                { "ierrors", LossAttributor::delta(last.port.ierrors, first.port.ierrors) },
+                { "unattributed", { { "imissed", unattributed.imissed },
+                                    { "rx_nombuf", unattributed.rx_nombuf },
+                                    { "checksum", unattributed.checksum } } } };
+
+  // Streams, summed up by sender (queue)
+  std::map<int, runreport::StreamLossCounters> sender_totals;
+  std::map<int, runreport::Attribution> sender_loss;
+  runreport::Attribution total_loss;
+  nlohmann::json streams = nlohmann::json::array();
+  for (std::size_t slot = 0; slot < m_slots.size(); ++slot) {
+    const auto& ss = m_slots[slot];
+    const auto& a = m_report_attr->streams()[slot];
+    runreport::StreamLossCounters d{ LossAttributor::delta(last.streams[slot].frames, first.streams[slot].frames),
+                                     LossAttributor::delta(last.streams[slot].lost_frames, first.streams[slot].lost_frames),
+                                     LossAttributor::delta(last.streams[slot].seq_id_gaps, first.streams[slot].seq_id_gaps),
+                                     LossAttributor::delta(last.streams[slot].source_dropped, first.streams[slot].source_dropped) };
+    streams.push_back({ { "queue", ss.rx_q }, { "sender", m_rxq_to_ip[ss.rx_q] }, { "stream", ss.stream_id },
+                        { "source_id", ss.source_id }, { "frames", d.frames }, { "lost_frames", d.lost_frames },
+                        { "seq_id_gaps", d.seq_id_gaps }, { "source_dropped", d.source_dropped }, { "loss", loss_json(a) } });
+
+    auto& st = sender_totals[ss.rx_q];
+    st.frames += d.frames;
+    st.lost_frames += d.lost_frames;
+    st.seq_id_gaps += d.seq_id_gaps;
+    st.source_dropped += d.source_dropped;
+    auto& sl = sender_loss[ss.rx_q];
+    for (auto* acc : { &sl, &total_loss }) {
+      acc->checksum += a.checksum;
+      acc->imissed += a.imissed;
+      acc->rx_nombuf += a.rx_nombuf;
+      acc->upstream += a.upstream;
+    }
+  }
+
+  nlohmann::json senders = nlohmann::json::array();
+  for (const auto& rx_q : m_rx_qs) {
+    const auto& fq = first.queues[rx_q];
+    const auto& lq = last.queues[rx_q];
+    nlohmann::json unexpected = nlohmann::json::object();
+    const auto& base = m_report_unexpected_base[rx_q];
+    for (int stream_id = 0; stream_id < s_num_stream_ids; ++stream_id) {
+      const uint64_t n = LossAttributor::delta(m_unexpected_rxq[rx_q][stream_id].load(std::memory_order_relaxed), base[stream_id]);
+      if (n) {
+        unexpected[std::to_string(stream_id)] = n;
+      }
+    }
+    const auto& st = sender_totals[rx_q];
+    senders.push_back({ { "queue", rx_q }, { "sender", m_rxq_to_ip[rx_q] },
+                        { "frames", LossAttributor::delta(lq.frames, fq.frames) },
+                        { "cksum_bad", LossAttributor::delta(lq.cksum_bad, fq.cksum_bad) },
+                        { "cksum_dropped", LossAttributor::delta(lq.cksum_dropped, fq.cksum_dropped) },
+                        { "unexpected_frames", LossAttributor::delta(lq.unexpected_frames, fq.unexpected_frames) },
+                        { "unexpected_streams", unexpected },
+                        { "lost_frames", st.lost_frames }, { "seq_id_gaps", st.seq_id_gaps },
+                        { "source_dropped", st.source_dropped }, { "loss", loss_json(sender_loss[rx_q]) } });
+  }
+  j["senders"] = senders;
+  j["streams"] = streams;
+
+  // Outages that ended during the run
+  nlohmann::json link_down = nlohmann::json::array();
+  {
+    std::lock_guard<std::mutex> lk(m_link_mutex);
+    for (const auto& d : m_link_down_intervals) {
+      if (d.start >= m_report_start_time) {
+        const auto start_ms = std::chrono::duration_cast<std::chrono::milliseconds>(d.start.time_since_epoch()).count();
+        link_down.push_back({ { "start_unix_ms", start_ms }, { "duration_ms", d.duration_ms } });
+      }
+    }
+  }
+  j["link_down"] = link_down;
+  j["loss"] = loss_json(total_loss);
+
+  const std::string file = m_report_file_base + ".json";
+  std::ofstream out(file, std::ios::trunc);
+  if (out) {
+    out << j.dump(2) << std::endl;
+  }
+  TLOG() << "Iface[" << m_iface_id << "] run " << m_report_run << ": " << total_loss.total() << " frames lost in "
+         << m_slots.size() << " streams (checksum " << total_loss.checksum << ", imissed " << total_loss.imissed
+         << ", rx_nombuf " << total_loss.rx_nombuf << ", upstream " << total_loss.upstream << "), report "
+         << (out ? "written to " + file : "not written, can't open " + file);
+}
+
+//-----------------------------------------------------------------------------
+void
+IfaceWrapper::fill_telemetry_queues(struct rte_tel_data* d)
+{
+  rte_tel_data_start_dict(d);
+  for (const auto& rx_q : m_rx_qs) {
+    struct rte_tel_data* q = rte_tel_data_alloc();
+    if (q == nullptr) {
+      return;
+    }
+    rte_tel_data_start_dict(q);
+    rte_tel_data_add_dict_u64(q, "packets", m_num_frames_rxq[rx_q].load(std::memory_order_relaxed));
+    rte_tel_data_add_dict_u64(q, "bytes", m_num_bytes_rxq[rx_q].load(std::memory_order_relaxed));
+    rte_tel_data_add_dict_u64(q, "full_bursts", m_num_full_bursts[rx_q].load(std::memory_order_relaxed));
+    rte_tel_data_add_dict_u64(q, "work_cycles", m_work_cycles_rxq[rx_q].load(std::memory_order_relaxed));
+    rte_tel_data_add_dict_u64(q, "cksum_bad", m_num_cksum_bad_rxq[rx_q].load(std::memory_order_relaxed));
+    rte_tel_data_add_dict_u64(q, "cksum_dropped", m_num_cksum_dropped_rxq[rx_q].load(std::memory_order_relaxed));
+    rte_tel_data_add_dict_u64(q, "ring_samples", m_ring_occupancy_rxq[rx_q].samples.load(std::memory_order_relaxed));
+    rte_tel_data_add_dict_u64(q, "ring_occupancy_sum", m_ring_occupancy_rxq[rx_q].sum.load(std::memory_order_relaxed));
+    if (rte_tel_data_add_dict_container(d, std::to_string(rx_q).c_str(), q, 0) != 0) {
+      rte_tel_data_free(q);
+      return;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void
+IfaceWrapper::fill_telemetry_sources(struct rte_tel_data* d)
+{
+  // Keyed by source id; a dict holds at most RTE_TEL_MAX_DICT_ENTRIES streams
+  rte_tel_data_start_dict(d);
+  for (std::size_t slot = 0; slot < m_slots.size(); ++slot) {
+    const auto& ss = m_slots[slot];
+    struct rte_tel_data* src = rte_tel_data_alloc();
+    if (src == nullptr) {
+      return;
+    }
+    rte_tel_data_start_dict(src);
+    rte_tel_data_add_dict_u64(src, "queue", ss.rx_q);
+    rte_tel_data_add_dict_u64(src, "stream", ss.stream_id);
+    rte_tel_data_add_dict_u64(src, "frames", m_stream_counters[slot].frames.load(std::memory_order_relaxed));
+    rte_tel_data_add_dict_u64(src, "bytes", m_stream_counters[slot].bytes.load(std::memory_order_relaxed));
+    rte_tel_data_add_dict_u64(src, "lost_frames", m_continuity[slot].lost_frames.load(std::memory_order_relaxed));
+    rte_tel_data_add_dict_u64(src, "seq_id_gaps", m_continuity[slot].seq_id_gaps.load(std::memory_order_relaxed));
+    rte_tel_data_add_dict_u64(src, "timestamp_anomalies", m_continuity[slot].timestamp_anomalies.load(std::memory_order_relaxed));
+    if (ss.source != nullptr) {
+      rte_tel_data_add_dict_u64(src, "sink_dropped", ss.source->get_dropped_frames());
+      rte_tel_data_add_dict_u64(src, "sink_cost_ns", ss.source->get_consumer_cost_ns());
+    }
+    if (rte_tel_data_add_dict_container(d, std::to_string(ss.source_id).c_str(), src, 0) != 0) {
+      rte_tel_data_free(src);
+      return;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void
+IfaceWrapper::fill_telemetry_lcores(struct rte_tel_data* d)
+{
+  rte_tel_data_start_dict(d);
+  for (auto& [lcore, stats] : m_lcore_stats) {
+    struct rte_tel_data* l = rte_tel_data_alloc();
+    if (l == nullptr) {
+      return;
+    }
+    rte_tel_data_start_dict(l);
+    rte_tel_data_add_dict_u64(l, "busy_cycles", stats.busy_cycles.load(std::memory_order_relaxed));
+    rte_tel_data_add_dict_u64(l, "idle_cycles", stats.idle_cycles.load(std::memory_order_relaxed));
+    rte_tel_data_add_dict_u64(l, "sleep_cycles", stats.sleep_cycles.load(std::memory_order_relaxed));
+    rte_tel_data_add_dict_u64(l, "polls", stats.polls.load(std::memory_order_relaxed));
+    rte_tel_data_add_dict_u64(l, "empty_polls", stats.empty_polls.load(std::memory_order_relaxed));
+    rte_tel_data_add_dict_u64(l, "packets", stats.packets.load(std::memory_order_relaxed));
+    if (rte_tel_data_add_dict_container(d, std::to_string(lcore).c_str(), l, 0) != 0) {
+      rte_tel_data_free(l);
+      return;
+    }
+  }
+  rte_tel_data_add_dict_u64(d, "tsc_hz", rte_get_tsc_hz());
 }
 
 //-----------------------------------------------------------------------------
@@ -389,10 +1857,7 @@ IfaceWrapper::garp_func()
 {  
   TLOG() << "Launching GARP sender...";
   while(m_run_marker.load()) {
-    for( const auto& ip_addr_bin : m_ip_addr_bin ) {
-      arp::pktgen_send_garp(m_garp_bufs[0][0], m_iface_id, ip_addr_bin);   
-    }
-    ++m_garps_sent;
+    send_garp();
     std::this_thread::sleep_for(std::chrono::seconds(1));
   }
   TLOG() << "GARP function joins.";
@@ -400,22 +1865,73 @@ IfaceWrapper::garp_func()
 
 //-----------------------------------------------------------------------------
 void
-IfaceWrapper::handle_eth_payload(int src_rx_q, char* payload, std::size_t size)
+IfaceWrapper::send_garp()
+{
+  std::lock_guard<std::mutex> lk(m_garp_mutex);
+  for( const auto& ip_addr_bin : m_ip_addr_bin ) {
+    arp::pktgen_send_garp(m_garp_bufs[0][0], m_iface_id, ip_addr_bin);
+    dpdklibs_trace_garp_send(m_iface_id, ip_addr_bin, rte_rdtsc());
+  }
+  ++m_garps_sent;
+}
+
+//-----------------------------------------------------------------------------
+bool
+IfaceWrapper::verify_burst_checksums(int src_rx_q, struct rte_mbuf** bufs, uint16_t nb_rx)
+{
+  if (udp::burst_cksum_all_good(bufs, nb_rx)) [[likely]] {
+    return true;
+  }
+  std::size_t bad = 0, unknown = 0;
+  for (uint16_t i = 0; i < nb_rx; ++i) {
+    auto status = udp::get_rx_cksum_status(bufs[i]->ol_flags);
+    bad += (status == udp::ChecksumStatus::kBad);
+    unknown += (status == udp::ChecksumStatus::kUnknown);
+  }
+  if (bad) {
+    m_num_cksum_bad_rxq[src_rx_q] += bad;
+  }
+  if (unknown) {
+    m_num_cksum_unknown_rxq[src_rx_q] += unknown;
+  }
+  return bad == 0;
+}
+
+//-----------------------------------------------------------------------------
+void
+IfaceWrapper::handle_eth_payload(int src_rx_q, char* payload, std::size_t size, uint64_t burst_tsc)
 {  
   // Get DAQ Header and its StreamID
   auto* daq_header = reinterpret_cast<dunedaq::detdataformats::DAQEthHeader*>(payload);
-  auto src_id = m_stream_id_to_source_id[src_rx_q][(unsigned)daq_header->stream_id];
+  const int slot = m_stream_slot[src_rx_q][daq_header->stream_id];
 
-  if ( auto src_it = m_sources.find(src_id); src_it != m_sources.end()) {
-    src_it->second->handle_payload(payload, size);
+  if (slot >= 0 && m_slots[slot].source != nullptr) [[likely]] {
+    if (m_continuity_check_stride) {
+      m_continuity[slot].check(daq_header->seq_id, daq_header->timestamp, m_continuity_check_stride);
+    }
+    if (rte_trace_point_is_enabled(&__dpdklibs_trace_rx_callback_return)) [[unlikely]] {
+      const uint64_t t_dispatch = rte_rdtsc();
+      dpdklibs_trace_rx_dispatch(src_rx_q, m_slots[slot].source_id, t_dispatch);
+      m_slots[slot].source->handle_payload(payload, size);
+      const uint64_t t_return = rte_rdtsc();
+      dpdklibs_trace_rx_callback_return(src_rx_q, m_slots[slot].source_id, t_return, t_return - t_dispatch);
+    } else {
+      m_slots[slot].source->handle_payload(payload, size);
+    }
+    // Liveness, stored once per burst so the watchdog's reads stay cheap
+    auto& seen = m_last_seen_tsc[slot];
+    if (seen.load(std::memory_order_relaxed) != burst_tsc) {
+      seen.store(burst_tsc, std::memory_order_relaxed);
+    }
+    auto& sc = m_stream_counters[slot];
+    sc.frames.store(sc.frames.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sc.bytes.store(sc.bytes.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
   } else {
     // Really bad -> unexpeced StreamID in UDP Payload.
     // This check is needed in order to avoid dynamically add thousands
     // of Sources on the fly, in case the data corruption is extremely severe.
-    if (m_num_unexid_frames.count(src_id) == 0) {
-      m_num_unexid_frames[src_id] = 0;
-    }
-    m_num_unexid_frames[src_id]++;
+    auto& c = m_unexpected_rxq[src_rx_q][daq_header->stream_id];
+    c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
   }
 }
 
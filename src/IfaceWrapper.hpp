@@ -18,7 +18,15 @@
 #include "dpdklibs/arp/ARP.hpp"
 #include "dpdklibs/ipv4_addr.hpp"
 #include "dpdklibs/XstatsHelper.hpp"
+#include "dpdklibs/FlowControl.hpp"
+#include "dpdklibs/LatencyHistogram.hpp"
+#include "dpdklibs/StreamContinuity.hpp"
+#include "dpdklibs/StatsMemzone.hpp"
+#include "dpdklibs/FlightRecorder.hpp"
+#include "dpdklibs/RunReport.hpp"
 #include "SourceConcept.hpp"
+#include "LcoreStats.hpp"
+#include "PacketCapture.hpp"
 
 #include <confmodel/Session.hpp>
 // #include <confmodel/NetworkDevice.hpp>
@@ -26,10 +34,18 @@
 #include "appmodel/NWDetDataSender.hpp"
 
 #include <nlohmann/json.hpp>
+#include <rte_cycles.h>
+#include <rte_telemetry.h>
+#include <google/protobuf/descriptor.h>
 
 #include <ers/ers.hpp>
 
+#include <array>
+#include <chrono>
+#include <deque>
+#include <fstream>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <set>
@@ -47,6 +63,14 @@ namespace dunedaq {
   
 namespace dpdklibs {
 
+  // What to do with frames whose IPv4/UDP checksum was flagged bad by the NIC
+  enum class ChecksumPolicy
+  {
+    kForward, // count only
+    kTag,     // count and report the offending queue/sender through ERS
+    kDrop     // count and don't forward to the sources
+  };
+
   class IfaceWrapper : public opmonlib::MonitorableObject
 {
 public:
@@ -70,14 +94,27 @@ public:
 
   void allocate_mbufs();
   void setup_interface();
-  void setup_flow_steering();
+  void setup_flow_steering(); // fatal if the rules can't be installed
   void setup_xstats();
   
-  void enable_flow() { m_lcore_enable_flow.store(true);}
+  void enable_flow() { m_flow_enabled_tsc.store(rte_rdtsc()); m_lcore_enable_flow.store(true);}
   void disable_flow() { m_lcore_enable_flow.store(false);}
   
   const std::vector<uint16_t>& get_rte_cores() const { return m_rte_cores; }
 
+  // Triggered pcapng capture; a non-empty sender IP selects its queue
+  bool start_capture(CaptureRequest req, const std::string& sender);
+
+  // End of run loss report, written off the data path: counters are
+  // sampled by the monitor thread, the files written by the caller of end
+  void begin_run_report(uint32_t run_number);
+  void end_run_report();
+
+  // Telemetry command payloads, built from the lcore counters on the caller's thread
+  void fill_telemetry_queues(struct rte_tel_data* d);
+  void fill_telemetry_sources(struct rte_tel_data* d);
+  void fill_telemetry_lcores(struct rte_tel_data* d);
+
 protected:
   //iface_conf_t m_cfg;
   int m_iface_id;
@@ -85,6 +122,40 @@ protected:
   bool m_configured;
 
   bool m_with_flow;
+  // DPDKPortTuning attributes, defaults for a plain DPDKPortConfiguration
+  bool m_flow_async = false;
+  uint32_t m_flow_async_queue_size = 64;
+  uint32_t m_sender_rate_limit_mbps = 0; // 0 disables HW policing
+  uint32_t m_sender_burst_kb = 1024;
+  ChecksumPolicy m_cksum_policy = ChecksumPolicy::kForward;
+  uint32_t m_ring_sample_stride = 64; // lcore loops between RX ring occupancy samples, 0 disables
+  uint64_t m_rx_offloads = ealutils::DEFAULT_RX_OFFLOADS; // requested, intersected with the device capabilities
+  bool m_set_link_fc = false; // false keeps the NIC defaults
+  enum rte_eth_fc_mode m_fc_mode = RTE_ETH_FC_NONE;
+  uint32_t m_fc_high_water = 0;
+  uint32_t m_fc_low_water = 0;
+  uint16_t m_fc_pause_time = 0xffff;
+  bool m_fc_autoneg = false;
+  int m_pfc_priority = -1; // -1 for link PAUSE instead of PFC
+  uint32_t m_continuity_check_stride = 1; // frames per checked seq_id/timestamp pair, 0 disables
+  uint32_t m_stream_silence_timeout_ms = 0; // silence after which a stream is flagged, 0 disables
+  uint32_t m_unexpected_warning_interval_s = 60; // min time between warnings of the same sender/stream
+  bool m_with_stats_zone = false; // shared stats memzone for secondary inspectors
+  uint32_t m_monitor_period_ms = 100; // stats memzone refresh and flight recorder trigger period
+  bool m_flight_recorder_enabled = false;
+  uint32_t m_flight_gap_trigger_us = 2000; // poll gap freezing the lcore's recorder, 0 disables
+  uint32_t m_flight_imissed_trigger = 1000; // imissed per monitor period freezing the recorders, 0 disables
+  uint32_t m_flight_max_dumps = 16; // per run
+  std::string m_flight_dump_dir = "/tmp";
+  bool m_perf_counters_enabled = false; // per lcore PMU counters through perf_event_open
+  uint32_t m_perf_sample_period_ms = 1000; // lcore time between two counter reads
+  bool m_link_recovery_enabled = false; // LSC/RESET event handling and port recovery
+  uint32_t m_link_down_reset_ms = 5000; // outage after which the port is first reset, 0 never
+  bool m_run_report_enabled = false;
+  uint32_t m_run_report_interval_ms = 1000; // time series and attribution granularity
+  std::string m_run_report_dir = "/tmp";
+  uint32_t m_capture_ring_size = 1024; // frames in flight between the lcores and the capture writer
+  uint32_t m_flow_queue_size = 0; // applied by the PMD, 0 if the async flow engine isn't configured
   bool m_prom_mode;
   std::vector<std::string> m_ip_addr;
   std::vector<rte_be32_t> m_ip_addr_bin;
@@ -108,11 +179,40 @@ private:
 
   // CPU core ID -> [queue -> ip]
   std::map<int, std::map<int, std::string>> m_rx_core_map;
+  // queue -> ip
+  std::map<int, std::string> m_rxq_to_ip;
+
+  // Template/async flow API objects (when m_flow_async)
+  FlowTemplateContext m_flow_templates;
+
+  // Port configuration as applied by the PMD
+  uint64_t m_applied_rx_offloads{ 0 };
+  uint16_t m_applied_mtu{ 0 };
+  bool m_rx_vector_path{ false };
+  bool m_tx_vector_path{ false };
+  std::string m_rx_burst_mode; // distinct modes of the RX queues
+  std::string m_tx_burst_mode;
+  uint32_t m_link_speed_mbps{ 0 }; // 0 while down or unknown
+
+  // HW meters policing the senders: rx queue -> meter id. The profile and
+  // policy are shared, and destroyed with the meters before a new setup.
+  static constexpr uint32_t s_meter_profile_id = 0;
+  static constexpr uint32_t s_meter_policy_id = 0;
+  bool m_meter_policy_installed{ false };
+  std::map<int, uint32_t> m_rxq_meters;
+  struct MeterSnapshot
+  {
+    uint64_t dropped_packets = 0;
+    bool policed = false;
+  };
+  std::map<int, MeterSnapshot> m_prev_meter_stats; // opmon thread only
+  void destroy_meters();
 
   // Lcore stop signal
   std::atomic<bool> m_lcore_quit_signal{ false };
 
   std::atomic<bool> m_lcore_enable_flow{ false };
+  std::atomic<uint64_t> m_flow_enabled_tsc{ 0 };
 
   // Mbufs and pools
   std::map<int, std::unique_ptr<rte_mempool>> m_mbuf_pools;
@@ -121,18 +221,130 @@ private:
   // Stats by queues
   std::map<int, std::atomic<std::size_t>> m_num_frames_rxq;
   std::map<int, std::atomic<std::size_t>> m_num_bytes_rxq;
-  std::map<int, std::atomic<std::size_t>> m_num_unexid_frames;
   std::map<int, std::atomic<std::size_t>> m_num_full_bursts;
   std::map<int, std::atomic<uint16_t>> m_max_burst_size;
+  std::map<int, std::atomic<std::size_t>> m_num_cksum_bad_rxq;
+  std::map<int, std::atomic<std::size_t>> m_num_cksum_unknown_rxq;
+  std::map<int, std::atomic<std::size_t>> m_num_cksum_dropped_rxq;
+  std::map<int, std::size_t> m_last_cksum_bad_rxq; // opmon thread only
+  std::map<int, std::atomic<uint64_t>> m_work_cycles_rxq;
+
+  // Cycle accounting by lcore
+  std::map<int, LcoreStats> m_lcore_stats;
+  std::map<int, LcoreStatsSnapshot> m_prev_lcore_stats; // opmon thread only
+  std::map<int, uint64_t> m_prev_work_cycles_rxq;       // opmon thread only
+  std::map<int, LcorePerfStats> m_lcore_perf;
+  std::map<int, LcorePerfSnapshot> m_prev_lcore_perf;   // opmon thread only
+
+  // Poll gap histograms by queue
+  std::map<int, PollGapHistogram> m_poll_gap_rxq;
+  std::map<int, std::array<uint64_t, PollGapHistogram::s_num_bins>> m_prev_poll_gap_rxq; // opmon thread only
+  std::map<int, bool> m_poll_gap_exceeded_rxq; // opmon thread only, for PollGapExceedsRing
+  std::map<int, int> m_rxq_to_lcore;
+  double m_ns_per_tsc_cycle{ 0. };
+
+  // RX ring occupancy by queue
+  std::map<int, RxRingOccupancy> m_ring_occupancy_rxq;
+  std::map<int, std::pair<uint64_t, uint64_t>> m_prev_ring_occupancy_rxq; // opmon thread only: sum, samples
+
+  // NIC arrival to end of dispatch latency by queue, in ns
+  std::map<int, LatencyHistogram> m_latency_rxq;
+  std::map<int, LatencyHistogram::counts_t> m_prev_latency_rxq; // opmon thread only
+
+  // HW RX timestamp dynfield, and NIC clock -> TSC calibration. The opmon
+  // thread publishes the calibration under a sequence lock (odd while being
+  // written); each lcore keeps a copy and re-reads it when the sequence moved.
+  struct ClockCalibration
+  {
+    uint64_t nic0 = 0;
+    uint64_t tsc0 = 0;
+    double tsc_per_nic = 0.;
+  };
+  bool m_hw_timestamps{ false };
+  int m_ts_dynfield_offset{ -1 };
+  uint64_t m_ts_dynflag{ 0 };
+  ClockCalibration m_clock_calib; // writer's copy
+  std::atomic<uint32_t> m_clock_calib_seq{ 0 };
+  std::atomic<uint64_t> m_clock_calib_nic0{ 0 };
+  std::atomic<uint64_t> m_clock_calib_tsc0{ 0 };
+  std::atomic<double> m_clock_calib_tsc_per_nic{ 0. };
+  void calibrate_nic_clock();
+  void read_clock_calibration(ClockCalibration& calib, uint32_t& seq) const; // lcores
 
   // DPDK HW stats
   dpdklibs::IfaceXstats m_iface_xstats;
 
+  // PAUSE frame xstats (rx_xon, rx_xoff, tx_xon, tx_xoff): index, previous value
+  static constexpr int s_num_pause_stats = 4;
+  std::array<int, s_num_pause_stats> m_pause_xstat_idx{ -1, -1, -1, -1 };
+  std::array<uint64_t, s_num_pause_stats> m_pause_xstat_prev{};
+
+  // Previous snapshot for the software deltas/rates (opmon thread only)
+  struct rte_eth_stats m_prev_eth_stats{};
+  std::map<int, uint64_t> m_prev_frames_rxq;
+  std::map<int, uint64_t> m_prev_bytes_rxq;
+  uint64_t m_last_opmon_tsc{ 0 };
+
+  // Published xstats, classified once in setup_xstats
+  enum class XstatGroup { kInfo, kErrors, kQueue };
+  struct XstatTarget
+  {
+    int idx;                                        // xstat ID
+    XstatGroup group;
+    const google::protobuf::FieldDescriptor* field; // in the group's message
+    std::size_t queue;                              // index in m_xstat_queue_labels
+  };
+  std::vector<XstatTarget> m_xstat_targets;
+  std::vector<std::string> m_xstat_queue_labels;
+
   // stream -> source id map indexed by queue id
   // queue -> [stream_id -> sid]
   std::map<int, std::map<uint, uint>> m_stream_id_to_source_id;
   sid_to_source_map_t& m_sources;
 
+  // Dispatch table, built once from the above: queue -> [stream_id -> slot],
+  // with -1 for streams not expected on the queue. Per-stream state is kept
+  // in dense arrays indexed by slot.
+  static constexpr int s_num_stream_ids = 256; // DAQEthHeader::stream_id is 8 bits
+  struct StreamSlot
+  {
+    int rx_q;
+    uint stream_id;
+    uint source_id;
+    SourceConcept* source; // nullptr if no source is registered for the source id
+  };
+  std::map<int, std::array<int, s_num_stream_ids>> m_stream_slot;
+  std::vector<StreamSlot> m_slots;
+  std::vector<StreamContinuity> m_continuity; // by slot
+  std::vector<StreamCounters> m_stream_counters; // by slot
+  struct StreamSnapshot
+  {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+  };
+  std::vector<StreamSnapshot> m_prev_stream_counters; // opmon thread only
+
+  // Liveness by slot: TSC of the last burst that carried frames of the
+  // stream, stored once per burst by the lcore and scanned by the watchdog
+  std::vector<std::atomic<uint64_t>> m_last_seen_tsc;
+  std::vector<uint8_t> m_slot_silent; // monitor thread only
+  uint64_t m_watch_since_tsc{ 0 };    // monitor thread only, flow enable time of the watched run
+  std::atomic<uint32_t> m_silent_streams{ 0 };
+  std::atomic<uint64_t> m_silence_events{ 0 };
+  void watch_streams(); // monitor thread
+
+  // Frames of streams not expected on the queue: queue -> [stream_id -> count].
+  // Dense like the dispatch table, so the lcore never inserts anything.
+  using stream_id_counts_t = std::array<std::atomic<uint64_t>, s_num_stream_ids>;
+  std::map<int, stream_id_counts_t> m_unexpected_rxq;
+  struct UnexpectedSnapshot
+  {
+    uint64_t frames = 0;
+    uint64_t warned_frames = 0;
+    uint64_t warned_tsc = 0;
+  };
+  std::map<int, std::array<UnexpectedSnapshot, s_num_stream_ids>> m_prev_unexpected_rxq; // opmon thread only
+
   // Run marker
   std::atomic<bool>& m_run_marker;
 
@@ -140,14 +352,95 @@ private:
   std::unique_ptr<rte_mempool> m_garp_mbuf_pool;
   std::map<int, struct rte_mbuf **> m_garp_bufs;
   std::thread m_garp_thread;
+  std::mutex m_garp_mutex; // TX queue 0 and the GARP mbuf, also used by the link recovery
   void garp_func();
+  void send_garp();
   std::atomic<uint64_t> m_garps_sent{0};
 
+  // Triggered capture
+  std::unique_ptr<PacketCapture> m_capture;
+
+  // Stats block in a named memzone, for secondary process inspectors
+  const struct rte_memzone* m_stats_zone{ nullptr };
+  void setup_stats_zone();
+  void update_stats_zone(const struct rte_eth_stats* eth);
+
+  // Recent burst history by lcore, dumped on loss anomalies
+  std::map<int, FlightRecorder> m_flight_recorders;
+  uint32_t m_flight_dumps{ 0 };
+  void dump_flight_recorders();
+
+  // End of run report: samples of the cumulative counters and the loss
+  // attribution, under the mutex (monitor thread and command thread)
+  std::mutex m_report_mutex;
+  bool m_report_active{ false };
+  uint32_t m_report_run{ 0 };
+  uint64_t m_report_next_tsc{ 0 };
+  uint32_t m_report_intervals{ 0 };
+  runreport::Sample m_report_first;
+  runreport::Sample m_report_last;
+  std::unique_ptr<runreport::LossAttributor> m_report_attr;
+  std::map<int, std::array<uint64_t, s_num_stream_ids>> m_report_unexpected_base;
+  std::ofstream m_report_series;
+  std::string m_report_file_base;
+  std::chrono::system_clock::time_point m_report_start_time;
+  runreport::Sample collect_run_sample();
+  void sample_run_report(); // monitor thread, every m_run_report_interval_ms
+  void write_run_report();
+
+  // Link state, followed by the monitor thread from the LSC/RESET events
+  // (recorded by the callback on the EAL interrupt thread) or by polling
+  // when the PMD has no LSC interrupt
+  static int eth_event_callback(uint16_t port_id, enum rte_eth_event_type type, void* cb_arg, void* ret_param);
+  bool m_eth_callbacks_registered{ false };
+  bool m_lsc_intr{ false };
+  std::atomic<uint64_t> m_lsc_interrupts{ 0 };
+  std::atomic<uint64_t> m_lsc_event_tsc{ 0 };
+  std::atomic<uint64_t> m_reset_events{ 0 };
+  std::atomic<bool> m_reset_requested{ false };
+  std::atomic<bool> m_link_up{ true };
+  std::atomic<bool> m_link_recovering{ false }; // read by the lcores
+  std::atomic<uint64_t> m_link_down_since_tsc{ 0 }; // ongoing outage, 0 when up
+  std::atomic<uint64_t> m_link_down_events{ 0 };
+  std::atomic<uint64_t> m_link_downtime_ns{ 0 }; // closed outages
+  std::atomic<uint64_t> m_link_longest_down_ns{ 0 };
+  std::atomic<uint64_t> m_link_last_down_ns{ 0 };
+  std::atomic<uint64_t> m_port_resets{ 0 };
+  std::atomic<uint64_t> m_failed_resets{ 0 };
+  static constexpr uint64_t s_max_reset_backoff_ms = 300000;
+  uint32_t m_outage_resets{ 0 };  // monitor thread only, resets during the ongoing outage
+  uint64_t m_next_reset_tsc{ 0 }; // monitor thread only
+  struct LinkDownInterval
+  {
+    std::chrono::system_clock::time_point start;
+    uint64_t duration_ms;
+  };
+  static constexpr std::size_t s_max_link_down_intervals = 64;
+  std::mutex m_link_mutex;
+  std::deque<LinkDownInterval> m_link_down_intervals; // most recent ones
+  void follow_link_state(); // monitor thread
+  bool reset_port();        // monitor thread
+  int install_flow_steering(); // 0, or a negative errno if a rule couldn't be installed
+
+  // Port reconfiguration: the lcores park without touching the port, and
+  // the opmon cycles that find the port mutex taken are skipped
+  std::mutex m_port_mutex;
+  std::atomic<bool> m_rx_paused{ false };
+  std::map<int, std::atomic<bool>> m_lcore_parked;
+  bool park_lcores();
+
+  // Fast non-lcore monitor: link state, stream watchdog, stats memzone, flight recorder triggers and run report samples
+  std::thread m_monitor_thread;
+  void monitor_func();
+
   // Lcore processor
   int rx_runner(void *arg __rte_unused);
 
+  // Per-burst checksum verification, returns true if the whole burst is good
+  bool verify_burst_checksums(int src_rx_q, struct rte_mbuf** bufs, uint16_t nb_rx);
+
   // What to do with every payload
-  void handle_eth_payload(int src_rx_q, char* payload, std::size_t size);
+  void handle_eth_payload(int src_rx_q, char* payload, std::size_t size, uint64_t burst_tsc);
 
 };
 
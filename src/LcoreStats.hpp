@@ -0,0 +1,162 @@
+/**
+ * @file LcoreStats.hpp Per lcore TSC based cycle accounting of the RX runners
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef DPDKLIBS_SRC_LCORESTATS_HPP_
+#define DPDKLIBS_SRC_LCORESTATS_HPP_
+
+#include "dpdklibs/PerfCounters.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace dunedaq {
+namespace dpdklibs {
+
+// Increment of a counter that has a single writer (the lcore owning it).
+// Avoids the locked read-modify-write of operator+= on the hot path.
+inline void
+add_relaxed(std::atomic<uint64_t>& counter, uint64_t value)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+// Written by the owning lcore only, read by the opmon thread.
+struct alignas(64) LcoreStats
+{
+  std::atomic<uint64_t> busy_cycles{ 0 };  // Loop iterations that received packets
+  std::atomic<uint64_t> idle_cycles{ 0 };  // Empty polls, excluding sleep
+  std::atomic<uint64_t> sleep_cycles{ 0 }; // Opportunistic nanosleep
+  std::atomic<uint64_t> empty_polls{ 0 };  // Loop iterations without any packet
+  std::atomic<uint64_t> polls{ 0 };
+  std::atomic<uint64_t> packets{ 0 };
+  std::atomic<uint64_t> recovery_packets{ 0 }; // Received while the link was being recovered
+
+  void reset()
+  {
+    busy_cycles = 0;
+    idle_cycles = 0;
+    sleep_cycles = 0;
+    empty_polls = 0;
+    polls = 0;
+    packets = 0;
+    recovery_packets = 0;
+  }
+};
+
+// Hardware counters of an lcore, accumulated by the lcore at each sample
+// together with the packets it received, so that ratios cover the same span
+struct alignas(64) LcorePerfStats
+{
+  std::atomic<uint32_t> available{ 0 }; // PerfCounters::available_mask() once opened
+  std::array<std::atomic<uint64_t>, PerfCounters::s_num_events> counts{};
+  std::atomic<uint64_t> packets{ 0 };
+
+  void reset()
+  {
+    available = 0;
+    for (auto& c : counts) {
+      c = 0;
+    }
+    packets = 0;
+  }
+};
+
+// Log2 histogram of the time between consecutive rx bursts on a queue.
+// Bin 0 counts gaps below 1.024 us, bin k gaps in [2^(k+9), 2^(k+10)) ns and
+// the last bin everything above.
+struct alignas(64) PollGapHistogram
+{
+  static constexpr int s_num_bins = 16;
+  static constexpr int s_first_bin_log2_ns = 10;
+
+  std::array<std::atomic<uint64_t>, s_num_bins> bins{};
+  std::atomic<uint64_t> max_gap_ns{ 0 }; // Since last read by the opmon thread
+
+  static int bin_of(uint64_t gap_ns)
+  {
+    const int log2_ns = 63 - __builtin_clzll(gap_ns | 1);
+    const int bin = log2_ns - s_first_bin_log2_ns + 1;
+    return bin < 0 ? 0 : (bin >= s_num_bins ? s_num_bins - 1 : bin);
+  }
+
+  void record(uint64_t gap_ns)
+  {
+    add_relaxed(bins[bin_of(gap_ns)], 1);
+    if (gap_ns > max_gap_ns.load(std::memory_order_relaxed)) {
+      max_gap_ns.store(gap_ns, std::memory_order_relaxed);
+    }
+  }
+
+  void reset()
+  {
+    for (auto& b : bins) {
+      b = 0;
+    }
+    max_gap_ns = 0;
+  }
+};
+
+// Sampled descriptor occupancy of an RX ring
+struct alignas(64) RxRingOccupancy
+{
+  std::atomic<uint64_t> sum{ 0 };
+  std::atomic<uint64_t> samples{ 0 };
+  std::atomic<uint32_t> max{ 0 }; // Since last read by the opmon thread
+
+  void record(uint32_t used)
+  {
+    add_relaxed(sum, used);
+    add_relaxed(samples, 1);
+    if (used > max.load(std::memory_order_relaxed)) {
+      max.store(used, std::memory_order_relaxed);
+    }
+  }
+
+  void reset()
+  {
+    sum = 0;
+    samples = 0;
+    max = 0;
+  }
+};
+
+// Frames and bytes dispatched to one stream, written by the lcore of its queue
+struct StreamCounters
+{
+  std::atomic<uint64_t> frames{ 0 };
+  std::atomic<uint64_t> bytes{ 0 };
+
+  void reset()
+  {
+    frames = 0;
+    bytes = 0;
+  }
+};
+
+// Opmon thread copy of the previous LcoreStats reading
+struct LcoreStatsSnapshot
+{
+  uint64_t busy_cycles = 0;
+  uint64_t idle_cycles = 0;
+  uint64_t sleep_cycles = 0;
+  uint64_t empty_polls = 0;
+  uint64_t polls = 0;
+  uint64_t packets = 0;
+};
+
+// Opmon thread copy of the previous LcorePerfStats reading
+struct LcorePerfSnapshot
+{
+  PerfCounters::counts_t counts{};
+  uint64_t packets = 0;
+};
+
+} // namespace dpdklibs
+} // namespace dunedaq
+
+#endif // DPDKLIBS_SRC_LCORESTATS_HPP_
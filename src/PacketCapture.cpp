@@ -0,0 +1,195 @@
+/**
+ * @file PacketCapture.cpp Triggered capture of received frames to pcapng
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "PacketCapture.hpp"
+
+#include "dpdklibs/PcapngWriter.hpp"
+#include "dpdklibs/udp/Utils.hpp"
+
+#include "detdataformats/DAQEthHeader.hpp"
+#include "logging/Logging.hpp"
+
+#include <rte_cycles.h>
+#include <rte_errno.h>
+
+#include <chrono>
+#include <fstream>
+#include <vector>
+
+namespace dunedaq {
+namespace dpdklibs {
+
+namespace {
+constexpr uint32_t s_snaplen = 9800;
+constexpr unsigned s_dequeue_burst = 32;
+} // namespace ""
+
+//-----------------------------------------------------------------------------
+PacketCapture::PacketCapture(int iface_id, int socket_id, uint32_t ring_size)
+  : m_iface_id(iface_id)
+  , m_socket_id(socket_id)
+  , m_ring_size(rte_align32pow2(ring_size))
+{}
+
+//-----------------------------------------------------------------------------
+PacketCapture::~PacketCapture()
+{
+  stop();
+  if (m_ring != nullptr) {
+    rte_ring_free(m_ring);
+  }
+  if (m_pool != nullptr) {
+    rte_mempool_free(m_pool);
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool
+PacketCapture::arm(const CaptureRequest& req)
+{
+  if (m_writer.joinable()) {
+    if (m_armed_rxq.load() != s_disarmed) {
+      TLOG() << "Iface[" << m_iface_id << "] capture already running";
+      return false;
+    }
+    m_writer.join();
+  }
+
+  // Created on the first capture only, then reused
+  if (m_pool == nullptr) {
+    // The private area holds the TSC at copy time
+    m_pool = rte_pktmbuf_pool_create(("CAPP-" + std::to_string(m_iface_id)).c_str(), m_ring_size, 0,
+                                     RTE_ALIGN(sizeof(uint64_t), RTE_MBUF_PRIV_ALIGN), RTE_PKTMBUF_HEADROOM + s_snaplen, m_socket_id);
+    if (m_pool == nullptr) {
+      TLOG() << "Iface[" << m_iface_id << "] can't create the capture pool: " << rte_strerror(rte_errno);
+      return false;
+    }
+  }
+  if (m_ring == nullptr) {
+    m_ring = rte_ring_create(("CAPR-" + std::to_string(m_iface_id)).c_str(), m_ring_size, m_socket_id, RING_F_SC_DEQ);
+    if (m_ring == nullptr) {
+      TLOG() << "Iface[" << m_iface_id << "] can't create the capture ring: " << rte_strerror(rte_errno);
+      return false;
+    }
+  }
+
+  // Copies enqueued by the lcores after the previous writer left
+  void* stale;
+  while (rte_ring_dequeue(m_ring, &stale) == 0) {
+    rte_pktmbuf_free(static_cast<struct rte_mbuf*>(stale));
+  }
+
+  m_captured = 0;
+  m_dropped = 0;
+  m_stream_id.store(req.stream_id, std::memory_order_relaxed);
+  m_remaining.store(req.count);
+  m_writer = std::thread(&PacketCapture::writer_func, this, req);
+  // Publishes the request: the lcores acquire it in armed_for()
+  m_armed_rxq.store(req.rx_q < 0 ? s_any_rxq : req.rx_q, std::memory_order_release);
+  TLOG() << "Iface[" << m_iface_id << "] capturing " << req.count << " frames of queue " << req.rx_q
+         << " stream " << req.stream_id << " to " << req.file;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void
+PacketCapture::stop()
+{
+  m_armed_rxq.store(s_disarmed);
+  if (m_writer.joinable()) {
+    m_writer.join();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void
+PacketCapture::offer(int /*rx_q*/, struct rte_mbuf** bufs, uint16_t nb_rx)
+{
+  const uint64_t tsc = rte_rdtsc();
+  const int stream_id = m_stream_id.load(std::memory_order_relaxed);
+  for (uint16_t i = 0; i < nb_rx; ++i) {
+    if (stream_id >= 0) {
+      if (bufs[i]->data_len < sizeof(udp::ipv4_udp_packet_hdr) + sizeof(detdataformats::DAQEthHeader)) {
+        continue;
+      }
+      auto* daq_header = reinterpret_cast<detdataformats::DAQEthHeader*>(udp::get_udp_payload(bufs[i]));
+      if (daq_header->stream_id != (unsigned)stream_id) {
+        continue;
+      }
+    }
+    if (m_remaining.fetch_sub(1, std::memory_order_relaxed) <= 0) {
+      m_armed_rxq.store(s_disarmed, std::memory_order_relaxed);
+      return;
+    }
+    struct rte_mbuf* copy = rte_pktmbuf_copy(bufs[i], m_pool, 0, s_snaplen);
+    if (copy == nullptr) {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    *static_cast<uint64_t*>(rte_mbuf_to_priv(copy)) = tsc;
+    // Original length kept in the (unused on RX copies) hash field
+    copy->hash.usr = bufs[i]->pkt_len;
+    if (rte_ring_enqueue(m_ring, copy) != 0) {
+      rte_pktmbuf_free(copy);
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void
+PacketCapture::writer_func(CaptureRequest req)
+{
+  std::ofstream out(req.file, std::ios::binary);
+  if (!out) {
+    TLOG() << "Iface[" << m_iface_id << "] can't open capture file " << req.file;
+  }
+  PcapngWriter writer(out);
+  writer.write_header(s_snaplen);
+
+  // Wall clock reference for the TSC stamps
+  const uint64_t tsc0 = rte_rdtsc();
+  const uint64_t wall0_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  const double ns_per_cycle = 1e9 / rte_get_tsc_hz();
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(req.timeout_s);
+
+  std::vector<char> linear(s_snaplen);
+  struct rte_mbuf* mbufs[s_dequeue_burst];
+  while (true) {
+    const unsigned n = rte_ring_dequeue_burst(m_ring, reinterpret_cast<void**>(mbufs), s_dequeue_burst, nullptr);
+    for (unsigned i = 0; i < n; ++i) {
+      const uint64_t tsc = *static_cast<uint64_t*>(rte_mbuf_to_priv(mbufs[i]));
+      const uint64_t ts_ns = wall0_ns + int64_t(tsc - tsc0) * ns_per_cycle;
+      const void* data = rte_pktmbuf_read(mbufs[i], 0, mbufs[i]->pkt_len, linear.data());
+      if (data != nullptr && out) {
+        writer.write_packet(ts_ns, data, mbufs[i]->pkt_len, mbufs[i]->hash.usr);
+        m_captured.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    rte_pktmbuf_free_bulk(mbufs, n);
+
+    if (n == 0) {
+      if (m_armed_rxq.load() == s_disarmed) {
+        break;
+      }
+      if (std::chrono::steady_clock::now() > deadline) {
+        TLOG() << "Iface[" << m_iface_id << "] capture timed out";
+        m_armed_rxq.store(s_disarmed);
+        // The lcores may still be enqueueing their last copies
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        continue;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  TLOG() << "Iface[" << m_iface_id << "] capture to " << req.file << " done: " << m_captured.load()
+         << " frames written, " << m_dropped.load() << " dropped";
+}
+
+} // namespace dpdklibs
+} // namespace dunedaq
@@ -0,0 +1,87 @@
+/**
+ * @file PacketCapture.hpp Triggered capture of received frames to pcapng
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef DPDKLIBS_SRC_PACKETCAPTURE_HPP_
+#define DPDKLIBS_SRC_PACKETCAPTURE_HPP_
+
+#include <rte_mbuf.h>
+#include <rte_mempool.h>
+#include <rte_ring.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace dunedaq {
+namespace dpdklibs {
+
+struct CaptureRequest
+{
+  int rx_q = -1;          // -1 for every queue of the interface
+  int stream_id = -1;     // -1 for every stream, otherwise DAQ frames of this stream only
+  uint32_t count = 1000;  // frames to capture
+  uint32_t timeout_s = 60;
+  std::string file;
+};
+
+// The lcores copy matching frames into a private pool and enqueue them on a
+// side ring; a writer thread drains the ring into the pcapng file. When the
+// ring or the pool are exhausted the frame is counted as dropped, the lcore
+// never waits for the writer.
+class PacketCapture
+{
+public:
+  PacketCapture(int iface_id, int socket_id, uint32_t ring_size);
+  ~PacketCapture();
+
+  PacketCapture(const PacketCapture&) = delete;            ///< PacketCapture is not copy-constructible
+  PacketCapture& operator=(const PacketCapture&) = delete; ///< PacketCapture is not copy-assginable
+  PacketCapture(PacketCapture&&) = delete;                 ///< PacketCapture is not move-constructible
+  PacketCapture& operator=(PacketCapture&&) = delete;      ///< PacketCapture is not move-assignable
+
+  // Returns false if a capture is already running or the resources can't be set up
+  bool arm(const CaptureRequest& req);
+  // Ends a running capture and waits for the writer
+  void stop();
+
+  // Lcore side
+  bool armed_for(int rx_q) const
+  {
+    const int armed = m_armed_rxq.load(std::memory_order_acquire);
+    return armed != s_disarmed && (armed == s_any_rxq || armed == rx_q);
+  }
+  void offer(int rx_q, struct rte_mbuf** bufs, uint16_t nb_rx);
+
+  uint64_t get_captured() const { return m_captured.load(std::memory_order_relaxed); }
+  uint64_t get_dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr int s_disarmed = -2;
+  static constexpr int s_any_rxq = -1;
+
+  void writer_func(CaptureRequest req);
+
+  int m_iface_id;
+  int m_socket_id;
+  uint32_t m_ring_size;
+  struct rte_mempool* m_pool{ nullptr };
+  struct rte_ring* m_ring{ nullptr };
+
+  std::atomic<int> m_armed_rxq{ s_disarmed };
+  std::atomic<int64_t> m_remaining{ 0 };
+  std::atomic<int> m_stream_id{ -1 }; // set before m_armed_rxq is released
+
+  std::atomic<uint64_t> m_captured{ 0 };
+  std::atomic<uint64_t> m_dropped{ 0 };
+  std::thread m_writer;
+};
+
+} // namespace dpdklibs
+} // namespace dunedaq
+
+#endif // DPDKLIBS_SRC_PACKETCAPTURE_HPP_
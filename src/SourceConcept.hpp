@@ -18,6 +18,7 @@
 //#include "packetformat/detail/block_parser.hpp"
 #include <nlohmann/json.hpp>
 
+#include <atomic>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -45,12 +46,29 @@ namespace dunedaq {
 
       virtual bool handle_payload(char* message, std::size_t size) = 0;
 
+      // Mean cost of handing one frame to the sink over the last opmon interval, in ns
+      virtual uint64_t get_consumer_cost_ns() const { return 0; }
+      // Frames the sink refused
+      virtual uint64_t get_dropped_frames() const { return 0; }
+
       void set_sink_name(const std::string& sink_name) 
       { 
 	m_sink_name = sink_name; 
       }
 
+      // Negotiated speed of the link feeding this source, sets the consumer cost budget
+      void set_line_rate_mbps(uint32_t line_rate_mbps)
+      {
+        m_line_rate_mbps.store(line_rate_mbps, std::memory_order_relaxed);
+      }
+
       std::string m_sink_name;
+
+    protected:
+      uint32_t get_line_rate_mbps() const { return m_line_rate_mbps.load(std::memory_order_relaxed); }
+
+    private:
+      std::atomic<uint32_t> m_line_rate_mbps{ 0 };
     };
 
   } // namespace dpdklibs
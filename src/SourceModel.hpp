@@ -9,12 +9,15 @@
 #define DPDKLIBS_SRC_SOURCEMODEL_HPP_
 
 #include "SourceConcept.hpp"
+#include "LcoreStats.hpp"
 
 
 #include "iomanager/IOManager.hpp"
 #include "iomanager/Sender.hpp"
 #include "logging/Logging.hpp"
 
+#include "dpdklibs/Issues.hpp"
+#include "dpdklibs/LatencyHistogram.hpp"
 #include "dpdklibs/opmon/SourceModel.pb.h"
 
 // #include "datahandlinglibs/utils/ReusableThread.hpp"
@@ -23,6 +26,8 @@
 // #include <folly/ProducerConsumerQueue.h>
 // #include <nlohmann/json.hpp>
 
+#include <rte_cycles.h>
+
 #include <atomic>
 #include <memory>
 #include <mutex>
@@ -87,16 +92,19 @@ public:
     if (push_out) {
 
       TargetPayloadType& target_payload = *reinterpret_cast<TargetPayloadType*>(message);
-  
-      if (m_callback_mode) {
-        (*m_sink_callback)(std::move(target_payload));
+
+      // Time every s_cost_sample_stride-th hand-off to the sink
+      if (--m_frames_to_cost_sample == 0) [[unlikely]] {
+        m_frames_to_cost_sample = s_cost_sample_stride;
+        const uint64_t t_send = rte_rdtsc();
+        send_to_sink(target_payload);
+        const uint64_t cycles = rte_rdtsc() - t_send;
+        m_sink_cost.record(cycles);
+        add_relaxed(m_sink_cost_cycles, cycles);
+        add_relaxed(m_sink_cost_samples, 1);
+        m_sampled_frame_size.store(size, std::memory_order_relaxed);
       } else {
-        if (!m_sink_queue->try_send(std::move(target_payload), iomanager::Sender::s_no_block)) {
-          //if(m_dropped_packets == 0 || m_dropped_packets%10000) {
-          //  TLOG() << "Dropped data " << m_dropped_packets;
-          //}
-          ++m_dropped_packets;
-        }
+        send_to_sink(target_payload);
       }
 
     } else {
@@ -108,15 +116,66 @@ public:
     return true;
   }
 
+  uint64_t get_consumer_cost_ns() const override { return m_consumer_cost_ns.load(std::memory_order_relaxed); }
+  uint64_t get_dropped_frames() const override { return m_dropped_packets.load(std::memory_order_relaxed); }
+
   void generate_opmon_data() override {
 
     opmon::SourceInfo info;
     info.set_dropped_frames( m_dropped_packets.load() ); 
 
     publish( std::move(info) );
+
+    // Sink cost over the interval. The budget is the wire time of a frame at
+    // line rate: above it the lcore can't keep up with a line-rate burst.
+    const double ns_per_cycle = 1e9 / rte_get_tsc_hz();
+    LatencyHistogram::counts_t interval;
+    m_sink_cost.delta(m_prev_sink_cost, interval);
+    const uint64_t cycles = m_sink_cost_cycles.load(std::memory_order_relaxed);
+    const uint64_t samples = m_sink_cost_samples.load(std::memory_order_relaxed);
+    const uint64_t d_cycles = cycles - m_prev_sink_cost_cycles;
+    const uint64_t d_samples = samples - m_prev_sink_cost_samples;
+    m_prev_sink_cost_cycles = cycles;
+    m_prev_sink_cost_samples = samples;
+
+    const uint64_t mean_ns = d_samples ? d_cycles * ns_per_cycle / d_samples : 0;
+    m_consumer_cost_ns.store(mean_ns, std::memory_order_relaxed);
+    const uint32_t line_rate_mbps = get_line_rate_mbps();
+    const uint64_t budget_ns = line_rate_mbps ? m_sampled_frame_size.load(std::memory_order_relaxed) * 8000 / line_rate_mbps : 0;
+
+    opmon::ConsumerCost cost;
+    cost.set_sampled_frames( d_samples );
+    cost.set_mean_ns( mean_ns );
+    cost.set_p50_ns( LatencyHistogram::percentile(interval, 0.5) * ns_per_cycle );
+    cost.set_p99_ns( LatencyHistogram::percentile(interval, 0.99) * ns_per_cycle );
+    cost.set_max_ns( m_sink_cost.max.exchange(0) * ns_per_cycle );
+    cost.set_budget_ns( budget_ns );
+    cost.set_callback_mode( m_callback_mode );
+    publish( std::move(cost) );
+
+    // Raised when the sink goes over budget, again only after an interval within it
+    const bool over_budget = budget_ns && mean_ns > budget_ns;
+    if (over_budget && !m_over_budget) {
+      ers::warning(SlowConsumer(ERS_HERE, m_sink_name, mean_ns, budget_ns));
+    }
+    m_over_budget = over_budget;
   }
   
 private:
+  void send_to_sink(TargetPayloadType& target_payload)
+  {
+    if (m_callback_mode) {
+      (*m_sink_callback)(std::move(target_payload));
+    } else {
+      if (!m_sink_queue->try_send(std::move(target_payload), iomanager::Sender::s_no_block)) {
+        //if(m_dropped_packets == 0 || m_dropped_packets%10000) {
+        //  TLOG() << "Dropped data " << m_dropped_packets;
+        //}
+        ++m_dropped_packets;
+      }
+    }
+  }
+
   // Sink internals
   std::string m_sink_id;
   bool m_sink_is_set{ false };
@@ -130,6 +189,21 @@ private:
 
   std::atomic<uint64_t> m_dropped_packets{0};
 
+  // Sink cost profiling, written by the lcore feeding this source
+  static constexpr uint32_t s_cost_sample_stride = 8; // frames between timed sink hand-offs
+  uint32_t m_frames_to_cost_sample = 1;
+  LatencyHistogram m_sink_cost; // TSC cycles per hand-off
+  std::atomic<uint64_t> m_sink_cost_cycles{ 0 };
+  std::atomic<uint64_t> m_sink_cost_samples{ 0 };
+  std::atomic<std::size_t> m_sampled_frame_size{ 0 };
+
+  // Opmon thread only
+  LatencyHistogram::counts_t m_prev_sink_cost{};
+  uint64_t m_prev_sink_cost_cycles = 0;
+  uint64_t m_prev_sink_cost_samples = 0;
+  std::atomic<uint64_t> m_consumer_cost_ns{ 0 };
+  bool m_over_budget{ false };
+
 };
 
 } // namespace dunedaq::dpdklibs
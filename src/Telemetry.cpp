@@ -0,0 +1,120 @@
+/**
+ * @file Telemetry.cpp DPDK telemetry commands serving the IfaceWrapper counters
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "Telemetry.hpp"
+#include "IfaceWrapper.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <rte_telemetry.h>
+
+#include <cstdlib>
+#include <map>
+#include <mutex>
+
+namespace dunedaq {
+namespace dpdklibs {
+namespace telemetry {
+
+namespace {
+
+std::mutex s_ifaces_mutex;
+std::map<int, IfaceWrapper*> s_ifaces;
+std::once_flag s_register_once;
+
+// Interface named in the parameters, or the first one registered
+IfaceWrapper*
+find_iface(const char* params)
+{
+  if (s_ifaces.empty()) {
+    return nullptr;
+  }
+  if (params == nullptr || *params == '\0') {
+    return s_ifaces.begin()->second;
+  }
+  char* end = nullptr;
+  long iface_id = std::strtol(params, &end, 10);
+  if (*end != '\0') {
+    return nullptr;
+  }
+  auto it = s_ifaces.find(iface_id);
+  return it != s_ifaces.end() ? it->second : nullptr;
+}
+
+int
+handle_ifaces(const char* /*cmd*/, const char* /*params*/, struct rte_tel_data* d)
+{
+  std::lock_guard<std::mutex> lk(s_ifaces_mutex);
+  rte_tel_data_start_array(d, RTE_TEL_INT_VAL);
+  for (const auto& [iface_id, _] : s_ifaces) {
+    rte_tel_data_add_array_int(d, iface_id);
+  }
+  return 0;
+}
+
+int
+handle_queues(const char* /*cmd*/, const char* params, struct rte_tel_data* d)
+{
+  std::lock_guard<std::mutex> lk(s_ifaces_mutex);
+  auto* iface = find_iface(params);
+  if (iface == nullptr) {
+    return -EINVAL;
+  }
+  iface->fill_telemetry_queues(d);
+  return 0;
+}
+
+int
+handle_sources(const char* /*cmd*/, const char* params, struct rte_tel_data* d)
+{
+  std::lock_guard<std::mutex> lk(s_ifaces_mutex);
+  auto* iface = find_iface(params);
+  if (iface == nullptr) {
+    return -EINVAL;
+  }
+  iface->fill_telemetry_sources(d);
+  return 0;
+}
+
+int
+handle_lcores(const char* /*cmd*/, const char* params, struct rte_tel_data* d)
+{
+  std::lock_guard<std::mutex> lk(s_ifaces_mutex);
+  auto* iface = find_iface(params);
+  if (iface == nullptr) {
+    return -EINVAL;
+  }
+  iface->fill_telemetry_lcores(d);
+  return 0;
+}
+
+} // namespace
+
+void
+register_iface(int iface_id, IfaceWrapper* iface)
+{
+  std::call_once(s_register_once, []() {
+    rte_telemetry_register_cmd("/dpdklibs/ifaces", handle_ifaces, "Returns the interface IDs served by dpdklibs. Takes no parameters");
+    rte_telemetry_register_cmd("/dpdklibs/queues", handle_queues, "Returns the RX queue counters. Parameters: int iface_id");
+    rte_telemetry_register_cmd("/dpdklibs/sources", handle_sources, "Returns the per-stream counters. Parameters: int iface_id");
+    rte_telemetry_register_cmd("/dpdklibs/lcores", handle_lcores, "Returns the RX lcore cycle accounting. Parameters: int iface_id");
+    TLOG() << "Registered /dpdklibs telemetry commands";
+  });
+  std::lock_guard<std::mutex> lk(s_ifaces_mutex);
+  s_ifaces[iface_id] = iface;
+}
+
+void
+deregister_iface(int iface_id)
+{
+  std::lock_guard<std::mutex> lk(s_ifaces_mutex);
+  s_ifaces.erase(iface_id);
+}
+
+} // namespace telemetry
+} // namespace dpdklibs
+} // namespace dunedaq
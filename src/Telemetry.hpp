@@ -0,0 +1,28 @@
+/**
+ * @file Telemetry.hpp DPDK telemetry commands serving the IfaceWrapper counters
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef DPDKLIBS_SRC_TELEMETRY_HPP_
+#define DPDKLIBS_SRC_TELEMETRY_HPP_
+
+namespace dunedaq {
+namespace dpdklibs {
+
+class IfaceWrapper;
+
+namespace telemetry {
+
+// Makes an interface visible to the /dpdklibs/... telemetry commands, which
+// are registered with the EAL telemetry on the first call. The commands run
+// on the telemetry thread and read the same relaxed counters as opmon.
+void register_iface(int iface_id, IfaceWrapper* iface);
+void deregister_iface(int iface_id);
+
+} // namespace telemetry
+} // namespace dpdklibs
+} // namespace dunedaq
+
+#endif // DPDKLIBS_SRC_TELEMETRY_HPP_
@@ -0,0 +1,19 @@
+/**
+ * @file TracePoints.cpp Registration of the dpdklibs rte_trace tracepoints
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+// Must come first: turns the declarations of TracePoints.hpp into definitions
+#include <rte_trace_point_register.h>
+
+#include "TracePoints.hpp"
+
+RTE_TRACE_POINT_REGISTER(dpdklibs_trace_rx_burst, dpdklibs.rx.burst)
+RTE_TRACE_POINT_REGISTER(dpdklibs_trace_rx_dispatch, dpdklibs.rx.dispatch)
+RTE_TRACE_POINT_REGISTER(dpdklibs_trace_rx_callback_return, dpdklibs.rx.callback_return)
+RTE_TRACE_POINT_REGISTER(dpdklibs_trace_rx_burst_done, dpdklibs.rx.burst_done)
+RTE_TRACE_POINT_REGISTER(dpdklibs_trace_garp_send, dpdklibs.garp.send)
+RTE_TRACE_POINT_REGISTER(dpdklibs_trace_flow_install, dpdklibs.flow.install)
+RTE_TRACE_POINT_REGISTER(dpdklibs_trace_opmon_poll, dpdklibs.opmon.poll)
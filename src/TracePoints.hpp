@@ -0,0 +1,82 @@
+/**
+ * @file TracePoints.hpp rte_trace tracepoints of the RX/TX paths
+ *
+ * Compiled in, disabled at runtime by default. Enable them with the EAL
+ * arguments --trace=dpdklibs.* (and --trace-dir=<dir>); the CTF output can
+ * be opened with babeltrace or Trace Compass.
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef DPDKLIBS_SRC_TRACEPOINTS_HPP_
+#define DPDKLIBS_SRC_TRACEPOINTS_HPP_
+
+#include <rte_trace_point.h>
+
+// Non-empty burst received on a queue
+RTE_TRACE_POINT(
+  dpdklibs_trace_rx_burst,
+  RTE_TRACE_POINT_ARGS(uint16_t iface, uint16_t rx_q, uint16_t nb_rx, uint64_t tsc),
+  rte_trace_point_emit_u16(iface);
+  rte_trace_point_emit_u16(rx_q);
+  rte_trace_point_emit_u16(nb_rx);
+  rte_trace_point_emit_u64(tsc);
+)
+
+// Frame handed to its source, and return of the source's handle_payload
+RTE_TRACE_POINT(
+  dpdklibs_trace_rx_dispatch,
+  RTE_TRACE_POINT_ARGS(uint16_t rx_q, uint32_t source_id, uint64_t tsc),
+  rte_trace_point_emit_u16(rx_q);
+  rte_trace_point_emit_u32(source_id);
+  rte_trace_point_emit_u64(tsc);
+)
+
+RTE_TRACE_POINT(
+  dpdklibs_trace_rx_callback_return,
+  RTE_TRACE_POINT_ARGS(uint16_t rx_q, uint32_t source_id, uint64_t tsc, uint64_t cycles),
+  rte_trace_point_emit_u16(rx_q);
+  rte_trace_point_emit_u32(source_id);
+  rte_trace_point_emit_u64(tsc);
+  rte_trace_point_emit_u64(cycles);
+)
+
+// End of the processing of a burst, with the cycles it took
+RTE_TRACE_POINT(
+  dpdklibs_trace_rx_burst_done,
+  RTE_TRACE_POINT_ARGS(uint16_t iface, uint16_t rx_q, uint16_t nb_rx, uint64_t tsc, uint64_t cycles),
+  rte_trace_point_emit_u16(iface);
+  rte_trace_point_emit_u16(rx_q);
+  rte_trace_point_emit_u16(nb_rx);
+  rte_trace_point_emit_u64(tsc);
+  rte_trace_point_emit_u64(cycles);
+)
+
+RTE_TRACE_POINT(
+  dpdklibs_trace_garp_send,
+  RTE_TRACE_POINT_ARGS(uint16_t iface, uint32_t ip_addr, uint64_t tsc),
+  rte_trace_point_emit_u16(iface);
+  rte_trace_point_emit_u32(ip_addr);
+  rte_trace_point_emit_u64(tsc);
+)
+
+RTE_TRACE_POINT(
+  dpdklibs_trace_flow_install,
+  RTE_TRACE_POINT_ARGS(uint16_t iface, uint32_t rules, uint8_t async, uint64_t tsc, uint64_t duration_us),
+  rte_trace_point_emit_u16(iface);
+  rte_trace_point_emit_u32(rules);
+  rte_trace_point_emit_u8(async);
+  rte_trace_point_emit_u64(tsc);
+  rte_trace_point_emit_u64(duration_us);
+)
+
+RTE_TRACE_POINT(
+  dpdklibs_trace_opmon_poll,
+  RTE_TRACE_POINT_ARGS(uint16_t iface, uint64_t tsc, uint64_t duration_us),
+  rte_trace_point_emit_u16(iface);
+  rte_trace_point_emit_u64(tsc);
+  rte_trace_point_emit_u64(duration_us);
+)
+
+#endif // DPDKLIBS_SRC_TRACEPOINTS_HPP_
@@ -1,14 +1,42 @@
 
+#include <rte_cycles.h>
+#include <rte_pause.h>
+
 #include <time.h>
 
 namespace dunedaq {
 namespace dpdklibs {
 
+void
+IfaceWrapper::read_clock_calibration(ClockCalibration& calib, uint32_t& seq) const
+{
+  uint32_t s = m_clock_calib_seq.load(std::memory_order_acquire);
+  while (s != seq) {
+    if (s & 1) {
+      rte_pause();
+      s = m_clock_calib_seq.load(std::memory_order_acquire);
+      continue;
+    }
+    ClockCalibration c;
+    c.nic0 = m_clock_calib_nic0.load(std::memory_order_relaxed);
+    c.tsc0 = m_clock_calib_tsc0.load(std::memory_order_relaxed);
+    c.tsc_per_nic = m_clock_calib_tsc_per_nic.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint32_t s_after = m_clock_calib_seq.load(std::memory_order_relaxed);
+    if (s_after == s) {
+      calib = c;
+      seq = s;
+    }
+    s = s_after;
+  }
+}
+
 int 
 IfaceWrapper::rx_runner(void *arg __rte_unused) {
 
   // Timespec for opportunistic sleep. Nanoseconds configured in conf.
   struct timespec sleep_request = { 0, (long)m_lcore_sleep_ns };
+  const struct timespec park_request = { 0, 10000 };
 
   bool once = true; // One shot action variable.
   uint16_t iface = m_iface_id;
@@ -23,16 +51,90 @@ IfaceWrapper::rx_runner(void *arg __rte_unused) {
 
   TLOG() << "LCore RX runner on CPU[" << lid << "]: Main loop starts for iface " << iface << " !";
 
+  // Cycle accounting of this lcore
+  auto& lstats = m_lcore_stats[lid];
+
   std::map<int, int> nb_rx_map;
+  std::map<int, uint64_t> last_burst_tsc;
+  const double ns_per_cycle = m_ns_per_tsc_cycle;
+  const uint32_t ring_sample_stride = m_ring_sample_stride;
+  const bool hw_timestamps = m_hw_timestamps;
+  const int ts_offset = m_ts_dynfield_offset;
+  const uint64_t ts_flag = m_ts_dynflag;
+  ClockCalibration calib;
+  uint32_t calib_seq = 1; // odd, never published: the first use reads it
+  uint32_t loops_to_ring_sample = ring_sample_stride;
+  // Flight recorder of this lcore, frozen by itself on long poll gaps
+  FlightRecorder* frec = m_flight_recorder_enabled ? &m_flight_recorders[lid] : nullptr;
+  const uint64_t gap_trigger_cycles = uint64_t(m_flight_gap_trigger_us) * rte_get_tsc_hz() / 1000000;
+
+  // Hardware counters of this thread, read at every sample period boundary
+  PerfCounters perf;
+  auto& pstats = m_lcore_perf[lid];
+  PerfCounters::counts_t perf_last{};
+  uint64_t perf_last_packets = 0;
+  uint64_t perf_next_tsc = 0; // 0 when not counting
+  const uint64_t perf_sample_cycles = uint64_t(m_perf_sample_period_ms) * rte_get_tsc_hz() / 1000;
+  if (m_perf_counters_enabled) {
+    if (perf.open() < PerfCounters::s_num_events) {
+      ers::warning(PerfCountersUnavailable(ERS_HERE, lid, perf.unavailable_events()));
+    }
+    if (perf.available_mask()) {
+      perf.read(perf_last);
+      perf_last_packets = lstats.packets.load(std::memory_order_relaxed);
+      pstats.available.store(perf.available_mask(), std::memory_order_relaxed);
+      perf_next_tsc = rte_rdtsc() + perf_sample_cycles;
+    }
+  }
+
   // While loop of quit atomic member in IfaceWrapper
   while(!this->m_lcore_quit_signal.load()) {
 
+    // Port being reset by the monitor thread: park without touching it
+    if (m_rx_paused.load(std::memory_order_acquire)) [[unlikely]] {
+      m_lcore_parked[lid].store(true);
+      while (m_rx_paused.load() && !m_lcore_quit_signal.load()) {
+        nanosleep(&park_request, nullptr);
+      }
+      m_lcore_parked[lid].store(false);
+      // The pause isn't a poll gap
+      for (auto& [rx_q, tsc] : last_burst_tsc) {
+        tsc = 0;
+      }
+      continue;
+    }
+
+    const uint64_t t_loop = rte_rdtsc();
+    uint32_t nb_rx_total = 0;
+
+    // Sample the RX ring occupancy every ring_sample_stride loops, before the bursts drain it
+    if (ring_sample_stride && --loops_to_ring_sample == 0) {
+      loops_to_ring_sample = ring_sample_stride;
+      for (const auto& q : queues) {
+        int used = rte_eth_rx_queue_count(iface, q.first);
+        if (used >= 0) {
+          m_ring_occupancy_rxq[q.first].record(used);
+        }
+      }
+    }
+
     // Loop over assigned queues to process
     uint8_t fb_count(0);
     for (const auto& q : queues) {
       auto src_rx_q = q.first;
       auto* q_bufs = m_bufs[src_rx_q];
 
+      // Gap since the previous burst on this queue
+      auto& last_tsc = last_burst_tsc[src_rx_q];
+      if (last_tsc) [[likely]] {
+        const uint64_t gap_cycles = t_loop - last_tsc;
+        m_poll_gap_rxq[src_rx_q].record(gap_cycles * ns_per_cycle);
+        if (frec && gap_trigger_cycles && gap_cycles > gap_trigger_cycles) [[unlikely]] {
+          frec->freeze(FlightTrigger::kPollGap, t_loop, gap_cycles * ns_per_cycle);
+        }
+      }
+      last_tsc = t_loop;
+
       // Get burst from queue
       const uint16_t nb_rx = rte_eth_rx_burst(iface, src_rx_q, q_bufs, m_burst_size);
       nb_rx_map[src_rx_q] = nb_rx;
@@ -48,7 +150,23 @@ IfaceWrapper::rx_runner(void *arg __rte_unused) {
       // We got packets from burst on this queue
       if (nb_rx != 0) [[likely]] {
 
+        const uint64_t t_queue = rte_rdtsc();
+        nb_rx_total += nb_rx;
+        dpdklibs_trace_rx_burst(iface, src_rx_q, nb_rx, t_queue);
+
+        // Arrival of the oldest frame in the burst, on the TSC time base
+        uint64_t arrival_tsc = t_loop;
+        if (hw_timestamps && (q_bufs[0]->ol_flags & ts_flag)) {
+          const auto nic_ts = *RTE_MBUF_DYNFIELD(q_bufs[0], ts_offset, rte_mbuf_timestamp_t*);
+          read_clock_calibration(calib, calib_seq);
+          arrival_tsc = calib.tsc0 + int64_t(nic_ts - calib.nic0) * calib.tsc_per_nic;
+        }
+
         m_max_burst_size[src_rx_q] = std::max(nb_rx, m_max_burst_size[src_rx_q].load());
+
+        // Checksum offload results, per-packet look only if the burst isn't all good
+        const bool drop_bad_cksum = !verify_burst_checksums(src_rx_q, q_bufs, nb_rx)
+                                    && m_cksum_policy == ChecksumPolicy::kDrop;
         // -------
 	      // Iterate on burst packets
         for (int i_b=0; i_b<nb_rx; ++i_b) {
@@ -85,18 +203,37 @@ IfaceWrapper::rx_runner(void *arg __rte_unused) {
             // Handle them!
             std::size_t data_len = q_bufs[i_b]->data_len;
 
+            if (drop_bad_cksum &&
+                udp::get_rx_cksum_status(q_bufs[i_b]->ol_flags) == udp::ChecksumStatus::kBad) [[unlikely]] {
+              ++m_num_cksum_dropped_rxq[src_rx_q];
+              continue;
+            }
+
             if ( m_lcore_enable_flow.load() ) [[likely]] {
               char* message = udp::get_udp_payload(q_bufs[i_b]);
-              handle_eth_payload(src_rx_q, message, data_len);
+              handle_eth_payload(src_rx_q, message, data_len, t_queue);
             }
             ++m_num_frames_rxq[src_rx_q];
             m_num_bytes_rxq[src_rx_q] += data_len;
           }
         }
 
+        // Triggered capture takes copies, never blocks
+        if (m_capture->armed_for(src_rx_q)) [[unlikely]] {
+          m_capture->offer(src_rx_q, q_bufs, nb_rx);
+        }
+
         // Bulk free of mbufs
         rte_pktmbuf_free_bulk(q_bufs, nb_rx);
 
+        const uint64_t t_dispatched = rte_rdtsc();
+        add_relaxed(m_work_cycles_rxq[src_rx_q], t_dispatched - t_queue);
+        m_latency_rxq[src_rx_q].record(t_dispatched > arrival_tsc ? (t_dispatched - arrival_tsc) * ns_per_cycle : 0);
+        dpdklibs_trace_rx_burst_done(iface, src_rx_q, nb_rx, t_dispatched, t_dispatched - t_queue);
+        if (frec) {
+          frec->record(t_queue, src_rx_q, nb_rx, t_dispatched - t_queue, 0);
+        }
+
         // -------
         
       } // per burst
@@ -108,11 +245,43 @@ IfaceWrapper::rx_runner(void *arg __rte_unused) {
       }
     } // per queue
 
+    const uint64_t t_work_end = rte_rdtsc();
+    add_relaxed(lstats.polls, 1);
+    if (nb_rx_total) {
+      add_relaxed(lstats.busy_cycles, t_work_end - t_loop);
+      add_relaxed(lstats.packets, nb_rx_total);
+      if (m_link_recovering.load(std::memory_order_relaxed)) [[unlikely]] {
+        add_relaxed(lstats.recovery_packets, nb_rx_total);
+      }
+    } else {
+      add_relaxed(lstats.idle_cycles, t_work_end - t_loop);
+      add_relaxed(lstats.empty_polls, 1);
+    }
+
+    // Counter reads cost a few rdpmc, once per sample period
+    if (perf_next_tsc && t_work_end >= perf_next_tsc) [[unlikely]] {
+      perf_next_tsc = t_work_end + perf_sample_cycles;
+      PerfCounters::counts_t now;
+      perf.read(now);
+      for (int e = 0; e < PerfCounters::s_num_events; ++e) {
+        add_relaxed(pstats.counts[e], now[e] - perf_last[e]);
+      }
+      perf_last = now;
+      const uint64_t packets = lstats.packets.load(std::memory_order_relaxed);
+      add_relaxed(pstats.packets, packets - perf_last_packets);
+      perf_last_packets = packets;
+    }
+
     // If no full buffers in burst...
     if (!fb_count) {
       if (m_lcore_sleep_ns) {
         // Sleep n nanoseconds... (value from config, timespec initialized in lcore first lines)
         /*int response =*/ nanosleep(&sleep_request, nullptr);
+        const uint64_t slept = rte_rdtsc() - t_work_end;
+        add_relaxed(lstats.sleep_cycles, slept);
+        if (frec) {
+          frec->record(t_work_end, FlightRecord::s_sleep_rxq, 0, 0, slept);
+        }
       }
     }
 
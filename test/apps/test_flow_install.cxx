@@ -0,0 +1,117 @@
+/* Installs N source IP steering rules on an interface, first one by one with
+ * the synchronous flow API, then through the template/async flow API, and
+ * reports the installation time of both. */
+
+#include "dpdklibs/EALSetup.hpp"
+#include "dpdklibs/FlowControl.hpp"
+#include "dpdklibs/RTEIfaceSetup.hpp"
+#include "logging/Logging.hpp"
+
+#include "CLI/App.hpp"
+#include "CLI/Config.hpp"
+#include "CLI/Formatter.hpp"
+
+#include <fmt/core.h>
+#include <fmt/ranges.h>
+
+#include <rte_eal.h>
+#include <rte_ethdev.h>
+#include <rte_flow.h>
+#include <rte_ip.h>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dpdklibs;
+
+int
+main(int argc, char** argv)
+{
+  uint16_t iface = 0;
+  uint32_t n_rules = 256;
+  uint16_t n_rx_qs = 4;
+  uint32_t async_queue_size = 64;
+  std::vector<std::string> pcie_addresses;
+
+  CLI::App app{ "test flow installation time" };
+  app.add_option("-m,--pcie-mask", pcie_addresses, "PCIE Addresses device mask");
+  app.add_option("-i,--iface", iface, "Interface to init");
+  app.add_option("-n,--num-rules", n_rules, "Number of source IP rules to install");
+  app.add_option("-q,--num-rx-queues", n_rx_qs, "Number of RX queues to spread the rules on");
+  app.add_option("-s,--async-queue-size", async_queue_size, "Flow queue size (batch size) of the async API");
+  CLI11_PARSE(app, argc, argv);
+
+  std::vector<std::string> eal_args;
+  eal_args.push_back("dpdklibs_test_flow_install");
+  for (const auto& pcie : pcie_addresses) {
+    eal_args.push_back("-a");
+    eal_args.push_back(pcie);
+  }
+  ealutils::init_eal(eal_args);
+
+  if (rte_eth_dev_count_avail() == 0) {
+    fmt::print("WARNING: no available ifaces. exiting...\n");
+    rte_eal_cleanup();
+    return 1;
+  }
+
+  std::map<int, std::unique_ptr<rte_mempool>> mbuf_pools;
+  for (uint16_t i = 0; i < n_rx_qs; ++i) {
+    std::stringstream ss;
+    ss << "MBP-" << i;
+    mbuf_pools[i] = ealutils::get_mempool(ss.str());
+  }
+  ealutils::iface_init(iface, n_rx_qs, 1, 1024, 1024, mbuf_pools);
+
+  // Synthetic sender IPs: 10.<hi>.<lo>.1
+  rxq_src_ip_list_t rules;
+  for (uint32_t r = 0; r < n_rules; ++r) {
+    rules.emplace_back(r % n_rx_qs, RTE_IPV4(10, (r >> 8) & 0xff, r & 0xff, 1));
+  }
+
+  struct rte_flow_error error;
+
+  // Synchronous path, as in IfaceWrapper::setup_flow_steering
+  rte_flow_flush(iface, &error);
+  auto t0 = std::chrono::steady_clock::now();
+  uint32_t n_sync = 0;
+  for (const auto& [rxq, src_ip] : rules) {
+    if (generate_ipv4_flow(iface, rxq, src_ip, 0xffffffff, 0, 0, &error) == nullptr) {
+      fmt::print("Sync flow creation failed at rule {}: {}\n", n_sync, error.message ? error.message : "n/a");
+      break;
+    }
+    ++n_sync;
+  }
+  auto sync_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+  rte_flow_flush(iface, &error);
+
+  // Template/async path
+  FlowTemplateContext ctx;
+  ctx.queue_size = async_queue_size;
+  t0 = std::chrono::steady_clock::now();
+  rte_eth_dev_stop(iface);
+  int retval = configure_async_flow_engine(iface, n_rules, ctx.queue_size, &error);
+  rte_eth_dev_start(iface);
+  if (retval == 0) {
+    retval = generate_ipv4_flows_async(iface, rules, ctx, &error);
+  }
+  auto async_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+  if (retval != 0) {
+    fmt::print("Async flow installation failed ({}): {}\n", retval, error.message ? error.message : "n/a");
+  }
+  destroy_flow_templates(ctx);
+
+  fmt::print("Rules requested: {}\n", n_rules);
+  fmt::print("  sync : {:6} rules in {:10} us ({:.2f} us/rule)\n", n_sync, sync_us, n_sync ? (double)sync_us / n_sync : 0.);
+  fmt::print("  async: {:6} rules in {:10} us ({:.2f} us/rule, batch {})\n",
+             retval == 0 ? n_rules : 0, async_us, (retval == 0 && n_rules) ? (double)async_us / n_rules : 0., ctx.queue_size);
+
+  rte_eth_dev_stop(iface);
+  rte_eal_cleanup();
+  return 0;
+}
@@ -0,0 +1,167 @@
+/* Compares the opmon cost of the xstats of an interface: polling all of them
+ * and classifying their names with std::regex on every cycle (as before the
+ * classification was moved to IfaceWrapper::setup_xstats), against polling
+ * only the published ones by ID into precomputed protobuf fields. */
+
+#include "dpdklibs/EALSetup.hpp"
+#include "dpdklibs/RTEIfaceSetup.hpp"
+#include "dpdklibs/XstatsHelper.hpp"
+#include "dpdklibs/opmon/IfaceWrapper.pb.h"
+#include "logging/Logging.hpp"
+#include "opmonlib/Utils.hpp"
+
+#include "CLI/App.hpp"
+#include "CLI/Config.hpp"
+#include "CLI/Formatter.hpp"
+
+#include <fmt/core.h>
+
+#include <rte_eal.h>
+#include <rte_ethdev.h>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dpdklibs;
+
+namespace {
+
+// Every cycle: all xstats, names matched with the regexes, values set by name
+void
+full_regex_cycle(IfaceXstats& xstats)
+{
+  xstats.poll();
+  opmon::EthXStatsInfo xinfos;
+  opmon::EthXStatsErrors xerrs;
+  std::map<std::string, opmon::QueueEthXStats> xq;
+  static const std::regex queue_regex(R"((rx|tx)_q(\d+)_([^_]+))");
+  static const std::regex err_regex(R"(.+error.*)");
+  for (int i = 0; i < xstats.m_len; ++i) {
+    std::string name(xstats.m_xstats_names[i].name);
+    std::smatch match;
+    try {
+      if (std::regex_match(name, match, queue_regex)) {
+        opmonlib::set_value(xq[match[1].str() + '-' + match[2].str()], match[3], xstats.m_xstats_values[i]);
+      } else if (std::regex_match(name, err_regex)) {
+        opmonlib::set_value(xerrs, name, xstats.m_xstats_values[i]);
+      } else {
+        opmonlib::set_value(xinfos, name, xstats.m_xstats_values[i]);
+      }
+    } catch (const ers::Issue&) {
+      // Not an opmon field
+    }
+  }
+}
+
+struct Target
+{
+  int idx;
+  google::protobuf::Message* msg;
+  const google::protobuf::FieldDescriptor* field;
+};
+
+// Every cycle: the published xstats by ID, set through their field descriptors
+void
+by_id_cycle(IfaceXstats& xstats, const std::vector<Target>& targets)
+{
+  xstats.poll();
+  for (const auto& t : targets) {
+    t.msg->GetReflection()->SetUInt64(t.msg, t.field, xstats.m_xstats_values[t.idx]);
+  }
+}
+
+template<typename F>
+double
+time_cycles_us(uint32_t n_cycles, F&& cycle)
+{
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t c = 0; c < n_cycles; ++c) {
+    cycle();
+  }
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+  return n_cycles ? double(us) / n_cycles : 0.;
+}
+
+} // namespace ""
+
+int
+main(int argc, char** argv)
+{
+  uint16_t iface = 0;
+  uint32_t n_cycles = 1000;
+  std::vector<std::string> pcie_addresses;
+
+  CLI::App app{ "test xstats opmon cycle cost" };
+  app.add_option("-m,--pcie-mask", pcie_addresses, "PCIE Addresses device mask");
+  app.add_option("-i,--iface", iface, "Interface to init");
+  app.add_option("-n,--num-cycles", n_cycles, "Number of opmon cycles to time per method");
+  CLI11_PARSE(app, argc, argv);
+
+  std::vector<std::string> eal_args;
+  eal_args.push_back("dpdklibs_test_xstats_poll");
+  for (const auto& pcie : pcie_addresses) {
+    eal_args.push_back("-a");
+    eal_args.push_back(pcie);
+  }
+  ealutils::init_eal(eal_args);
+
+  if (rte_eth_dev_count_avail() == 0) {
+    fmt::print("WARNING: no available ifaces. exiting...\n");
+    rte_eal_cleanup();
+    return 1;
+  }
+
+  std::map<int, std::unique_ptr<rte_mempool>> mbuf_pools;
+  mbuf_pools[0] = ealutils::get_mempool("MBP-0");
+  ealutils::iface_init(iface, 1, 1, 1024, 1024, mbuf_pools);
+
+  IfaceXstats full;
+  full.setup(iface);
+
+  // Classification done once, as in IfaceWrapper::setup_xstats
+  IfaceXstats selected;
+  selected.setup(iface);
+  opmon::EthXStatsInfo xinfos;
+  opmon::EthXStatsErrors xerrs;
+  std::map<std::string, opmon::QueueEthXStats> xq;
+  std::vector<Target> targets;
+  std::vector<uint64_t> ids;
+  const std::regex queue_regex(R"((rx|tx)_q(\d+)_([^_]+))");
+  const std::regex err_regex(R"(.+error.*)");
+  for (int i = 0; i < selected.m_len; ++i) {
+    std::string name(selected.m_xstats_names[i].name);
+    std::smatch match;
+    google::protobuf::Message* msg = &xinfos;
+    std::string field_name = name;
+    if (std::regex_match(name, match, queue_regex)) {
+      msg = &xq[match[1].str() + '-' + match[2].str()];
+      field_name = match[3].str();
+    } else if (std::regex_match(name, err_regex)) {
+      msg = &xerrs;
+    }
+    auto field = msg->GetDescriptor()->FindFieldByName(field_name);
+    if (field == nullptr || field->cpp_type() != google::protobuf::FieldDescriptor::CPPTYPE_UINT64) {
+      continue;
+    }
+    targets.push_back({ i, msg, field });
+    ids.push_back(i);
+  }
+  selected.select(ids);
+
+  const double full_us = time_cycles_us(n_cycles, [&] { full_regex_cycle(full); });
+  const double by_id_us = time_cycles_us(n_cycles, [&] { by_id_cycle(selected, targets); });
+
+  fmt::print("Iface {}: {} xstats, {} published\n", iface, full.m_len, targets.size());
+  fmt::print("  all + regex : {:10.2f} us/cycle\n", full_us);
+  fmt::print("  by ID       : {:10.2f} us/cycle ({:.1f}x)\n", by_id_us, by_id_us > 0 ? full_us / by_id_us : 0.);
+
+  rte_eth_dev_stop(iface);
+  rte_eal_cleanup();
+  return 0;
+}
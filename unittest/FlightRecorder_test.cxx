@@ -0,0 +1,90 @@
+/**
+ * @file FlightRecorder_test.cxx
+ *
+ * Test the wrap, freeze, requested freeze and dump/load round trip of the flight recorder
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dpdklibs/FlightRecorder.hpp"
+
+#define BOOST_TEST_MODULE FlightRecorder_test // NOLINT
+
+#include "TRACE/trace.h"
+#include "boost/test/unit_test.hpp"
+
+#include <memory>
+#include <sstream>
+#include <vector>
+
+using namespace dunedaq::dpdklibs;
+
+BOOST_AUTO_TEST_SUITE(FlightRecorder_test)
+
+BOOST_AUTO_TEST_CASE(WrapFreezeDump)
+{
+  auto fr = std::make_unique<FlightRecorder>();
+  const uint64_t n = FlightRecorder::s_num_records + 100;
+  for (uint64_t i = 0; i < n; ++i) {
+    fr->record(1000 + i, i % 4, 32, 500, 0);
+  }
+  BOOST_REQUIRE(fr->freeze(FlightTrigger::kPollGap, 5000, 1234));
+  BOOST_REQUIRE(!fr->freeze(FlightTrigger::kImissed, 6000, 1));
+
+  // Frozen: not recorded
+  fr->record(99999, 0, 1, 1, 0);
+  BOOST_REQUIRE_EQUAL(fr->head.load(), n);
+
+  std::stringstream ss;
+  fr->dump(ss, 1, 3, 2000000000);
+
+  FlightDumpHeader hdr;
+  std::vector<FlightRecord> records;
+  BOOST_REQUIRE(FlightRecorder::load(ss, hdr, records));
+  BOOST_REQUIRE_EQUAL(hdr.iface_id, 1);
+  BOOST_REQUIRE_EQUAL(hdr.lcore, 3);
+  BOOST_REQUIRE_EQUAL(hdr.trigger, static_cast<uint32_t>(FlightTrigger::kPollGap));
+  BOOST_REQUIRE_EQUAL(hdr.trigger_value, 1234);
+  BOOST_REQUIRE_EQUAL(hdr.total_records, n);
+  BOOST_REQUIRE_EQUAL(records.size(), FlightRecorder::s_num_records);
+  // Oldest first: the first 100 were overwritten
+  BOOST_REQUIRE_EQUAL(records.front().tsc, 1000 + 100);
+  BOOST_REQUIRE_EQUAL(records.back().tsc, 1000 + n - 1);
+
+  fr->thaw();
+  fr->record(99999, 0, 1, 1, 0);
+  BOOST_REQUIRE_EQUAL(fr->head.load(), n + 1);
+}
+
+BOOST_AUTO_TEST_CASE(RequestedFreeze)
+{
+  auto fr = std::make_unique<FlightRecorder>();
+  fr->record(1000, 0, 32, 500, 0);
+  BOOST_REQUIRE(fr->request_freeze(FlightTrigger::kImissed, 2000, 7));
+  BOOST_REQUIRE(!fr->request_freeze(FlightTrigger::kManual, 3000, 1));
+  BOOST_REQUIRE_EQUAL(fr->frozen.load(), 0);
+
+  // Taken by the next record, which is not written
+  fr->record(1001, 0, 32, 500, 0);
+  BOOST_REQUIRE_EQUAL(fr->head.load(), 1);
+  BOOST_REQUIRE_EQUAL(fr->frozen.load(), static_cast<uint32_t>(FlightTrigger::kImissed));
+  BOOST_REQUIRE_EQUAL(fr->trigger_tsc, 2000);
+  BOOST_REQUIRE_EQUAL(fr->trigger_value, 7);
+  BOOST_REQUIRE_EQUAL(fr->freeze_request.load(), 0);
+
+  fr->thaw();
+  fr->record(1002, 0, 32, 500, 0);
+  BOOST_REQUIRE_EQUAL(fr->head.load(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(BadFile)
+{
+  std::stringstream ss("not a flight recorder dump");
+  FlightDumpHeader hdr;
+  std::vector<FlightRecord> records;
+  BOOST_REQUIRE(!FlightRecorder::load(ss, hdr, records));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,67 @@
+/**
+ * @file LatencyHistogram_test.cxx
+ *
+ * Test the bucketing and percentile extraction of the latency histogram
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dpdklibs/LatencyHistogram.hpp"
+
+#define BOOST_TEST_MODULE LatencyHistogram_test // NOLINT
+
+#include "TRACE/trace.h"
+#include "boost/test/unit_test.hpp"
+
+#include <memory>
+
+using namespace dunedaq::dpdklibs;
+
+BOOST_AUTO_TEST_SUITE(LatencyHistogram_test)
+
+BOOST_AUTO_TEST_CASE(Buckets)
+{
+  // Every value lands in the bucket whose range contains it
+  for (uint64_t v = 0; v < (1 << 16); ++v) {
+    int b = LatencyHistogram::bucket_of(v);
+    BOOST_REQUIRE_LE(v, LatencyHistogram::bucket_upper(b));
+    if (b > 0) {
+      BOOST_REQUIRE_GT(v, LatencyHistogram::bucket_upper(b - 1));
+    }
+  }
+
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::bucket_of(7), 7);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::bucket_upper(LatencyHistogram::bucket_of(16)), 17);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::bucket_of(~uint64_t(0)), LatencyHistogram::s_num_buckets - 1);
+}
+
+BOOST_AUTO_TEST_CASE(Percentiles)
+{
+  auto hist = std::make_unique<LatencyHistogram>();
+  LatencyHistogram::counts_t prev{}, interval{};
+
+  hist->delta(prev, interval);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::percentile(interval, 0.5), 0);
+
+  for (uint64_t i = 1; i <= 1000; ++i) {
+    hist->record(i * 1000);
+  }
+  BOOST_REQUIRE_EQUAL(hist->max.load(), 1000000);
+
+  hist->delta(prev, interval);
+  auto p50 = LatencyHistogram::percentile(interval, 0.5);
+  auto p99 = LatencyHistogram::percentile(interval, 0.99);
+  BOOST_CHECK_GE(p50, 500000);
+  BOOST_CHECK_LE(p50, 500000 * 1.125);
+  BOOST_CHECK_GE(p99, 990000);
+  BOOST_CHECK_LE(p99, 990000 * 1.125);
+
+  // Only the new values show up in the next interval
+  hist->record(10);
+  hist->delta(prev, interval);
+  BOOST_REQUIRE_EQUAL(LatencyHistogram::percentile(interval, 1.0), 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
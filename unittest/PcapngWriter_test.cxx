@@ -0,0 +1,73 @@
+/**
+ * @file PcapngWriter_test.cxx
+ *
+ * Test the block layout produced by the pcapng writer
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dpdklibs/PcapngWriter.hpp"
+
+#define BOOST_TEST_MODULE PcapngWriter_test // NOLINT
+
+#include "TRACE/trace.h"
+#include "boost/test/unit_test.hpp"
+
+#include <cstring>
+#include <sstream>
+#include <string>
+
+using namespace dunedaq::dpdklibs;
+
+namespace {
+
+uint32_t
+get32(const std::string& s, std::size_t off)
+{
+  uint32_t v;
+  std::memcpy(&v, s.data() + off, sizeof(v));
+  return v;
+}
+
+} // namespace ""
+
+BOOST_AUTO_TEST_SUITE(PcapngWriter_test)
+
+BOOST_AUTO_TEST_CASE(Blocks)
+{
+  std::ostringstream out;
+  PcapngWriter w(out);
+  w.write_header(9000);
+  const char frame[] = "0123456789"; // 10 bytes, padded to 12
+  w.write_packet(0x123456789ULL, frame, 10, 60);
+
+  const std::string s = out.str();
+  BOOST_REQUIRE_EQUAL(s.size(), 28 + 32 + 32 + 12);
+
+  // SHB
+  BOOST_REQUIRE_EQUAL(get32(s, 0), PcapngWriter::s_shb_type);
+  BOOST_REQUIRE_EQUAL(get32(s, 4), 28);
+  BOOST_REQUIRE_EQUAL(get32(s, 8), PcapngWriter::s_byte_order_magic);
+  BOOST_REQUIRE_EQUAL(get32(s, 24), 28);
+
+  // IDB
+  BOOST_REQUIRE_EQUAL(get32(s, 28), PcapngWriter::s_idb_type);
+  BOOST_REQUIRE_EQUAL(get32(s, 32), 32);
+  BOOST_REQUIRE_EQUAL(get32(s, 40), 9000);
+  BOOST_REQUIRE_EQUAL(get32(s, 56), 32);
+
+  // EPB
+  const std::size_t epb = 60;
+  BOOST_REQUIRE_EQUAL(get32(s, epb), PcapngWriter::s_epb_type);
+  BOOST_REQUIRE_EQUAL(get32(s, epb + 4), 44);
+  BOOST_REQUIRE_EQUAL(get32(s, epb + 12), 0x1);
+  BOOST_REQUIRE_EQUAL(get32(s, epb + 16), 0x23456789);
+  BOOST_REQUIRE_EQUAL(get32(s, epb + 20), 10);
+  BOOST_REQUIRE_EQUAL(get32(s, epb + 24), 60);
+  BOOST_REQUIRE_EQUAL(s.substr(epb + 28, 10), std::string(frame, 10));
+  BOOST_REQUIRE_EQUAL(get32(s, epb + 40), 44);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
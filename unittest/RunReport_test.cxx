@@ -0,0 +1,104 @@
+/**
+ * @file RunReport_test.cxx
+ *
+ * Test the loss attribution and the time series round trip of the run report
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dpdklibs/RunReport.hpp"
+
+#define BOOST_TEST_MODULE RunReport_test // NOLINT
+
+#include "TRACE/trace.h"
+#include "boost/test/unit_test.hpp"
+
+#include <sstream>
+#include <vector>
+
+using namespace dunedaq::dpdklibs::runreport;
+
+namespace {
+
+Sample
+make_sample(uint64_t tsc, std::size_t queues, std::size_t streams)
+{
+  Sample s;
+  s.tsc = tsc;
+  s.queues.resize(queues);
+  s.streams.resize(streams);
+  return s;
+}
+
+} // namespace ""
+
+BOOST_AUTO_TEST_SUITE(RunReport_test)
+
+BOOST_AUTO_TEST_CASE(Attribution)
+{
+  // Two queues, streams 0 and 1 on queue 0, stream 2 on queue 1
+  LossAttributor attr({ 0, 0, 1 });
+  Sample s0 = make_sample(0, 2, 3);
+
+  // Interval 1: 3 checksum drops on queue 0, 4 imissed, 1 rx_nombuf.
+  // Stream 0 lost 5, stream 1 lost 2, stream 2 lost 4.
+  Sample s1 = s0;
+  s1.queues[0].cksum_dropped = 3;
+  s1.port.imissed = 4;
+  s1.port.rx_nombuf = 1;
+  s1.streams[0].lost_frames = 5;
+  s1.streams[1].lost_frames = 2;
+  s1.streams[2].lost_frames = 4;
+  attr.add_interval(s0, s1);
+
+  // Stream 0: 3 checksum, 2 imissed
+  BOOST_REQUIRE_EQUAL(attr.streams()[0].checksum, 3);
+  BOOST_REQUIRE_EQUAL(attr.streams()[0].imissed, 2);
+  BOOST_REQUIRE_EQUAL(attr.streams()[0].upstream, 0);
+  // Stream 1: 2 imissed
+  BOOST_REQUIRE_EQUAL(attr.streams()[1].imissed, 2);
+  // Stream 2: no checksum drop on queue 1, imissed used up, 1 rx_nombuf, 3 upstream
+  BOOST_REQUIRE_EQUAL(attr.streams()[2].checksum, 0);
+  BOOST_REQUIRE_EQUAL(attr.streams()[2].imissed, 0);
+  BOOST_REQUIRE_EQUAL(attr.streams()[2].rx_nombuf, 1);
+  BOOST_REQUIRE_EQUAL(attr.streams()[2].upstream, 3);
+  BOOST_REQUIRE_EQUAL(attr.unattributed().imissed, 0);
+
+  // Interval 2: drops without any stream gap stay unattributed
+  Sample s2 = s1;
+  s2.port.imissed += 7;
+  attr.add_interval(s1, s2);
+  BOOST_REQUIRE_EQUAL(attr.unattributed().imissed, 7);
+  BOOST_REQUIRE_EQUAL(attr.streams()[0].total(), 5);
+}
+
+BOOST_AUTO_TEST_CASE(SeriesRoundTrip)
+{
+  const std::vector<int> slot_queue{ 0, 1 };
+  SeriesHeader hdr{ SeriesHeader::s_magic, SeriesHeader::s_version, 2, 1234, 2, 2, 2000000000 };
+  std::stringstream ss;
+  write_series_header(ss, hdr, slot_queue);
+  for (uint64_t i = 1; i <= 3; ++i) {
+    Sample s = make_sample(i * 1000, 2, 2);
+    s.port.imissed = i;
+    s.queues[1].frames = 10 * i;
+    s.streams[0].lost_frames = 100 * i;
+    write_series_record(ss, s);
+  }
+
+  SeriesHeader rhdr;
+  std::vector<int> rslot_queue;
+  std::vector<Sample> samples;
+  BOOST_REQUIRE(read_series(ss, rhdr, rslot_queue, samples));
+  BOOST_REQUIRE_EQUAL(rhdr.run_number, 1234);
+  BOOST_REQUIRE(rslot_queue == slot_queue);
+  BOOST_REQUIRE_EQUAL(samples.size(), 3);
+  BOOST_REQUIRE_EQUAL(samples[2].tsc, 3000);
+  BOOST_REQUIRE_EQUAL(samples[2].port.imissed, 3);
+  BOOST_REQUIRE_EQUAL(samples[2].queues[1].frames, 30);
+  BOOST_REQUIRE_EQUAL(samples[2].streams[0].lost_frames, 300);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
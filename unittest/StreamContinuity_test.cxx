@@ -0,0 +1,72 @@
+/**
+ * @file StreamContinuity_test.cxx
+ *
+ * Test the seq_id wrap and timestamp step handling of the continuity checker
+ *
+ * This is part of the DUNE DAQ Application Framework, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "dpdklibs/StreamContinuity.hpp"
+
+#define BOOST_TEST_MODULE StreamContinuity_test // NOLINT
+
+#include "TRACE/trace.h"
+#include "boost/test/unit_test.hpp"
+
+#include <memory>
+
+using namespace dunedaq::dpdklibs;
+
+BOOST_AUTO_TEST_SUITE(StreamContinuity_test)
+
+BOOST_AUTO_TEST_CASE(ContinuousStream)
+{
+  auto c = std::make_unique<StreamContinuity>();
+  uint64_t ts = 1000;
+  // Crosses the 4096 wrap twice
+  for (uint32_t i = 0; i < 10000; ++i) {
+    c->check((i + 4000) % 4096, ts, 1);
+    ts += 2048;
+  }
+  BOOST_REQUIRE_EQUAL(c->pairs_checked.load(), 9999);
+  BOOST_REQUIRE_EQUAL(c->seq_id_gaps.load(), 0);
+  BOOST_REQUIRE_EQUAL(c->lost_frames.load(), 0);
+  BOOST_REQUIRE_EQUAL(c->timestamp_anomalies.load(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(GapAcrossWrap)
+{
+  auto c = std::make_unique<StreamContinuity>();
+  c->check(4094, 0, 1);
+  c->check(4095, 2048, 1);
+  // 0, 1, 2 are lost
+  c->check(3, 5 * 2048, 1);
+  BOOST_REQUIRE_EQUAL(c->seq_id_gaps.load(), 1);
+  BOOST_REQUIRE_EQUAL(c->lost_frames.load(), 3);
+  BOOST_REQUIRE_EQUAL(c->max_seq_id_skip.load(), 3);
+  // The timestamp moved by the lost frames too: not an anomaly
+  BOOST_REQUIRE_EQUAL(c->timestamp_anomalies.load(), 0);
+
+  // Timestamp jump without seq_id gap
+  c->check(4, 5 * 2048 + 100000, 1);
+  BOOST_REQUIRE_EQUAL(c->timestamp_anomalies.load(), 1);
+  BOOST_REQUIRE_EQUAL(c->max_timestamp_deviation.load(), 100000 - 2048);
+}
+
+BOOST_AUTO_TEST_CASE(Sampled)
+{
+  auto c = std::make_unique<StreamContinuity>();
+  uint64_t ts = 0;
+  for (uint32_t i = 0; i < 1600; ++i) {
+    c->check(i % 4096, ts, 16);
+    ts += 2048;
+  }
+  // One pair every 16 frames
+  BOOST_REQUIRE_EQUAL(c->pairs_checked.load(), 100);
+  BOOST_REQUIRE_EQUAL(c->lost_frames.load(), 0);
+  BOOST_REQUIRE_EQUAL(c->timestamp_anomalies.load(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -114,5 +114,29 @@ BOOST_AUTO_TEST_CASE(GetEthernetPackets)
   BOOST_CHECK_NO_THROW(udp::get_ethernet_packets(buffervec)); // Just a quick check that we got things to return to normal
 
 }
-  
+
+BOOST_AUTO_TEST_CASE(RxChecksumStatus)
+{
+  constexpr uint64_t good = RTE_MBUF_F_RX_IP_CKSUM_GOOD | RTE_MBUF_F_RX_L4_CKSUM_GOOD;
+
+  BOOST_CHECK(udp::get_rx_cksum_status(good) == udp::ChecksumStatus::kGood);
+  BOOST_CHECK(udp::get_rx_cksum_status(RTE_MBUF_F_RX_IP_CKSUM_NONE | RTE_MBUF_F_RX_L4_CKSUM_GOOD) == udp::ChecksumStatus::kGood);
+  BOOST_CHECK(udp::get_rx_cksum_status(RTE_MBUF_F_RX_IP_CKSUM_BAD | RTE_MBUF_F_RX_L4_CKSUM_GOOD) == udp::ChecksumStatus::kBad);
+  BOOST_CHECK(udp::get_rx_cksum_status(RTE_MBUF_F_RX_IP_CKSUM_GOOD | RTE_MBUF_F_RX_L4_CKSUM_BAD) == udp::ChecksumStatus::kBad);
+  BOOST_CHECK(udp::get_rx_cksum_status(RTE_MBUF_F_RX_IP_CKSUM_GOOD) == udp::ChecksumStatus::kUnknown);
+  BOOST_CHECK(udp::get_rx_cksum_status(0) == udp::ChecksumStatus::kUnknown);
+
+  std::vector<rte_mbuf> mbufs(8);
+  std::vector<rte_mbuf*> bufs;
+  for (auto& m : mbufs) {
+    m.ol_flags = good;
+    bufs.push_back(&m);
+  }
+  BOOST_CHECK(udp::burst_cksum_all_good(bufs.data(), bufs.size()));
+
+  mbufs[5].ol_flags = RTE_MBUF_F_RX_IP_CKSUM_GOOD | RTE_MBUF_F_RX_L4_CKSUM_BAD;
+  BOOST_CHECK(!udp::burst_cksum_all_good(bufs.data(), bufs.size()));
+  BOOST_CHECK(udp::burst_cksum_all_good(bufs.data(), 5));
+}
+
 BOOST_AUTO_TEST_SUITE_END()